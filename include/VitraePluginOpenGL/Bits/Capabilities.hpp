@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Vitrae/Data/Typedefs.hpp"
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+#include <ostream>
+#include <unordered_set>
+
+namespace Vitrae
+{
+
+/**
+ * @brief Limits and optional features of the GL implementation,
+ * queried once after the main context is created
+ */
+struct GLCapabilities
+{
+    // implementation info
+    String vendor;
+    String renderer;
+    String version;
+    String glslVersion;
+    GLint majorVersion = 0;
+    GLint minorVersion = 0;
+
+    // buffer limits
+    GLint maxUniformBlockSize = 16384;
+    GLint maxUniformBufferBindings = 36;
+    GLint uniformBufferOffsetAlignment = 256;
+    GLint maxShaderStorageBlockSize = 1 << 27;
+    GLint maxShaderStorageBufferBindings = 8;
+    GLint shaderStorageBufferOffsetAlignment = 256;
+
+    // texture and framebuffer limits
+    GLint maxCombinedTextureImageUnits = 80;
+    GLint maxTextureSize = 1024;
+    GLint maxColorAttachments = 8;
+    GLint maxDrawBuffers = 8;
+    GLint maxVertexAttribs = 16;
+
+    // interface limits
+    GLint maxUniformLocations = 1024;
+    GLint maxVaryingVectors = 15;
+
+    // compute limits
+    glm::ivec3 maxComputeWorkGroupSize = {1024, 1024, 64};
+    glm::ivec3 maxComputeWorkGroupCount = {65535, 65535, 65535};
+    GLint maxComputeWorkGroupInvocations = 1024;
+
+    // dedicated video memory in bytes, or 0 if the driver doesn't report it
+    std::size_t dedicatedVideoMemory = 0;
+
+    // optional features
+    bool hasParallelShaderCompile = false;
+    bool hasBufferStorage = false;
+    bool hasMultiDrawIndirect = false;
+    bool hasDirectStateAccess = false;
+    bool hasSpirV = false;
+    bool hasSeparateShaderObjects = false;
+    bool hasProgramBinary = false;
+    bool hasPipelineStatisticsQuery = false;
+
+    std::unordered_set<String> extensions;
+
+    /**
+     * @brief Queries the capabilities of the current context
+     */
+    static GLCapabilities query();
+
+    bool hasExtension(const String &name) const;
+    bool isVersionAtLeast(GLint major, GLint minor) const;
+
+    /**
+     * @returns the compute group size used when none is specified
+     */
+    glm::ivec3 getAutoComputeGroupSize() const;
+
+    void print(std::ostream &out) const;
+};
+
+} // namespace Vitrae
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Vitrae/Data/Typedefs.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <unordered_set>
+#include <vector>
+
+namespace Vitrae
+{
+
+/**
+ * @brief Stream buffer that appends into one growable string, keeping its capacity when cleared
+ */
+class GLCodeBuffer : public std::streambuf
+{
+  public:
+    void clear();
+    StringView getCode() const;
+
+  protected:
+    String m_code;
+
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char *s, std::streamsize count) override;
+};
+
+/**
+ * @brief Prefixed identifiers stored in reused memory chunks, each kept only once
+ * @note The returned views stay valid until reset()
+ */
+class GLIdentifierArena
+{
+  public:
+    StringView intern(StringView prefix, StringView name);
+    void reset();
+
+  protected:
+    static constexpr std::size_t CHUNK_SIZE = 16 * 1024;
+
+    struct Chunk
+    {
+        std::unique_ptr<char[]> p_data;
+        std::size_t size;
+    };
+
+    std::vector<Chunk> m_chunks;
+    std::size_t m_chunkIndex = 0;
+    std::size_t m_chunkOffset = 0;
+    std::unordered_set<StringView> m_identifiers;
+
+    char *allocate(std::size_t size);
+};
+
+/**
+ * @brief Storage for generating the code of programs, reused between them to avoid allocations
+ * @note Not thread-safe; use one per thread
+ */
+class GLCodeWriter
+{
+  public:
+    GLCodeWriter();
+    GLCodeWriter(const GLCodeWriter &) = delete;
+    GLCodeWriter &operator=(const GLCodeWriter &) = delete;
+
+    /**
+     * @returns the stream writing into the code buffer;
+     * a stringstream, as that's what shader tasks write into
+     */
+    std::stringstream &stream();
+
+    StringView getCode() const;
+    void clearCode();
+
+    /**
+     * @returns the identifier prefix + name, valid until reset()
+     */
+    StringView intern(StringView prefix, StringView name);
+
+    /**
+     * @brief Clears the code and the identifiers, keeping the memory for the next program
+     */
+    void reset();
+
+  protected:
+    GLCodeBuffer m_buffer;
+    GLIdentifierArena m_identifiers;
+    std::stringstream m_stream;
+};
+
+} // namespace Vitrae
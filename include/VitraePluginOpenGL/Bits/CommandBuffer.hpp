@@ -0,0 +1,141 @@
+#pragma once
+
+#include "Vitrae/Data/Typedefs.hpp"
+#include "Vitrae/Dynamic/VariantScope.hpp"
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <variant>
+#include <vector>
+
+namespace Vitrae
+{
+
+struct GLConversionSpec;
+
+/**
+ * @brief A list of GL operations recorded without a GL context, to be replayed on the render
+ * thread
+ * @note Recording isn't synchronized; each recording thread should own its command buffer
+ */
+class GLCommandBuffer
+{
+  public:
+    /**
+     * @param orderKey decides the replay order of buffers submitted during the same frame.
+     * Buffers with the same key are replayed in the order of submission, so for a deterministic
+     * replay each recording thread should use its own key
+     */
+    GLCommandBuffer(std::uint32_t orderKey = 0);
+
+    /**
+     * @brief Records a glNamedBufferSubData. The data is copied
+     */
+    void bufferSubData(GLuint buffer, std::size_t offset, const void *data, std::size_t size);
+
+    /**
+     * @brief Records a glTextureSubImage2D of the whole given region. The data is copied
+     */
+    void textureSubImage2D(GLuint texture, GLint level, glm::ivec2 offset, glm::ivec2 size,
+                           GLenum format, GLenum type, const void *data, std::size_t dataSize);
+
+    /**
+     * @brief Records setting a uniform of a program using the type's conversion.
+     * The value is copied
+     */
+    void setUniform(GLuint program, GLint location, const GLConversionSpec &convSpec,
+                    const Variant &hostValue);
+
+    /**
+     * @brief Records an arbitrary operation
+     */
+    void call(std::function<void()> command);
+
+    /**
+     * @brief Executes the recorded commands
+     * @note Has to be called with the context enabled
+     */
+    void replay() const;
+
+    void clear();
+    bool empty() const;
+    std::size_t size() const;
+    inline std::uint32_t getOrderKey() const { return m_orderKey; }
+
+  protected:
+    struct BufferSubDataCmd
+    {
+        GLuint buffer;
+        std::size_t offset;
+        std::size_t dataOffset, dataSize;
+    };
+    struct TextureSubImage2DCmd
+    {
+        GLuint texture;
+        GLint level;
+        glm::ivec2 offset, size;
+        GLenum format, type;
+        std::size_t dataOffset;
+    };
+    struct SetUniformCmd
+    {
+        GLuint program;
+        GLint location;
+        const GLConversionSpec *p_convSpec;
+        Variant hostValue;
+    };
+    using Command =
+        std::variant<BufferSubDataCmd, TextureSubImage2DCmd, SetUniformCmd, std::function<void()>>;
+
+    std::uint32_t m_orderKey;
+    std::vector<Command> m_commands;
+    std::vector<unsigned char> m_data;
+
+    std::size_t storeData(const void *data, std::size_t size);
+};
+
+/**
+ * @brief Collects command buffers from any thread and replays them on the render thread
+ * @note Submitting is lock-free
+ */
+class GLCommandQueue
+{
+  public:
+    GLCommandQueue() = default;
+    GLCommandQueue(const GLCommandQueue &) = delete;
+    ~GLCommandQueue();
+
+    /**
+     * @brief Queues the buffer for the next replay. Callable from any thread
+     */
+    void submit(GLCommandBuffer &&buffer);
+
+    /**
+     * @brief Replays all submitted buffers, ordered by their order keys and then by submission
+     * @note Has to be called on the thread with the context enabled
+     */
+    void replayAll();
+
+  protected:
+    struct Node
+    {
+        GLCommandBuffer buffer;
+        std::uint64_t sequence;
+
+        // owned by the list while queued, and by m_replayOrder while replaying
+        Node *p_next;
+    };
+
+    std::atomic<Node *> m_head = nullptr;
+    std::atomic<std::uint64_t> m_nextSequence = 0;
+
+    // reused between replays
+    std::vector<std::unique_ptr<Node>> m_replayOrder;
+};
+
+} // namespace Vitrae
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "glad/glad.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+namespace Vitrae
+{
+
+/**
+ * @returns a human readable category for the GL debug message type,
+ * or nullptr if messages of the type aren't reported
+ */
+const char *getGLDebugTypeDescription(GLenum type);
+
+/**
+ * @brief Collects GL debug messages and periodically reports a summary per message id
+ * @note record() is lock-free and can be called directly from the GL debug callback
+ */
+class GLDebugAggregator
+{
+  public:
+    static constexpr std::size_t NUM_SLOTS = 256;
+    static constexpr std::size_t MAX_MESSAGE_LENGTH = 256;
+
+    GLDebugAggregator(std::ostream &out, std::chrono::milliseconds flushInterval);
+    ~GLDebugAggregator();
+
+    void record(GLenum type, GLuint id, const GLchar *message, GLsizei length);
+
+    /**
+     * @brief Writes the counts gathered since the last flush
+     */
+    void flush();
+
+  protected:
+    struct Slot
+    {
+        // message id + 1, so 0 marks an empty slot
+        std::atomic<std::uint64_t> key = 0;
+        // set after the message text is written
+        std::atomic<bool> ready = false;
+        std::atomic<std::uint64_t> count = 0;
+
+        GLenum type;
+        char message[MAX_MESSAGE_LENGTH];
+    };
+
+    std::ostream &m_out;
+    std::chrono::milliseconds m_flushInterval;
+
+    std::array<Slot, NUM_SLOTS> m_slots;
+    std::atomic<std::uint64_t> m_numDropped = 0;
+
+    std::mutex m_flushMutex;
+    std::condition_variable m_stopCondition;
+    bool m_stopping = false;
+    std::thread m_flushThread;
+};
+
+} // namespace Vitrae
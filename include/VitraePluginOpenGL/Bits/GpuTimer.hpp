@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Vitrae/Data/Typedefs.hpp"
+
+#include "glad/glad.h"
+
+#include <cstddef>
+#include <limits>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace Vitrae
+{
+
+/**
+ * @brief Measures GPU time of nested scopes with timestamp queries
+ * @note Results are read back numFramesInFlight frames later, and only if already available,
+ * so the timing never stalls the CPU. Scopes opened from non-owner threads are ignored.
+ */
+class GLGpuTimer
+{
+  public:
+    struct ScopeTiming
+    {
+        String name;
+        std::size_t depth;
+        double milliseconds;
+    };
+
+    /**
+     * @brief RAII timing of a scope on the GPU timeline
+     */
+    class Scope
+    {
+      public:
+        Scope(GLGpuTimer &timer, StringView name);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+      private:
+        GLGpuTimer &m_timer;
+        std::size_t m_index;
+        std::size_t m_frameSerial;
+    };
+
+    GLGpuTimer(std::size_t numFramesInFlight, std::size_t maxScopesPerFrame);
+    ~GLGpuTimer();
+
+    /**
+     * @brief Creates the queries on the current context, and makes the calling thread the owner
+     */
+    void setup();
+    void free();
+    bool isEnabled() const;
+
+    /**
+     * @brief Collects the results of the oldest frame in flight and starts a new frame
+     */
+    void nextFrame();
+
+    /**
+     * @returns timings of the latest frame that had its results available, in scope order
+     */
+    const std::vector<ScopeTiming> &getLastResults() const;
+
+    /**
+     * @returns the number of frames whose results weren't ready in time and got discarded
+     */
+    std::size_t getNumDroppedFrames() const;
+
+    void printLastResults(std::ostream &out) const;
+
+  protected:
+    static constexpr std::size_t NO_SCOPE = std::numeric_limits<std::size_t>::max();
+
+    struct ScopeRecord
+    {
+        String name;
+        std::size_t depth;
+    };
+
+    struct Frame
+    {
+        // begin and end timestamp for each scope
+        std::vector<GLuint> queries;
+        std::vector<ScopeRecord> scopes;
+    };
+
+    std::size_t m_maxScopesPerFrame;
+    std::vector<Frame> m_frames;
+    std::size_t m_currentFrameIndex;
+    std::size_t m_frameSerial;
+    // scopes of the current frame that haven't ended yet
+    std::vector<std::size_t> m_openScopes;
+    std::thread::id m_ownerThreadId;
+    bool m_enabled;
+
+    std::vector<ScopeTiming> m_lastResults;
+    std::size_t m_numDroppedFrames;
+
+    std::size_t beginScope(StringView name);
+    void endScope(std::size_t index, std::size_t frameSerial);
+};
+
+} // namespace Vitrae
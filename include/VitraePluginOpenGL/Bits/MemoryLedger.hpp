@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace Vitrae
+{
+
+enum class GLMemoryCategory {
+    Textures,
+    Buffers,
+    Framebuffers,
+    Programs,
+    COUNT
+};
+
+/**
+ * @brief Renderer-wide tally of the video memory held by GL objects
+ * @note Assets register their GPU footprint on creation and release it on destruction.
+ * When the total goes over the budget, the registered evictors get asked to free the excess.
+ */
+class GLMemoryLedger
+{
+  public:
+    /**
+     * @brief Frees unused assets
+     * @param bytes how many bytes should be freed
+     * @returns how many bytes were freed
+     */
+    using Evictor = std::function<std::size_t(std::size_t bytes)>;
+
+    GLMemoryLedger();
+
+    /**
+     * @param budget the total video memory to stay under, or 0 for no limit
+     */
+    void setBudget(std::size_t budget);
+    std::size_t getBudget() const;
+
+    void add(GLMemoryCategory category, std::size_t bytes);
+    void remove(GLMemoryCategory category, std::size_t bytes);
+
+    std::size_t getUsage(GLMemoryCategory category) const;
+    std::size_t getTotalUsage() const;
+    bool isOverBudget() const;
+
+    void addEvictor(Evictor evictor);
+
+    /**
+     * @brief Calls the evictors in order of registration until the usage is within budget
+     * @note Should be called from the thread that owns the evicted assets
+     */
+    void enforceBudget();
+
+    void print(std::ostream &out) const;
+
+  protected:
+    std::array<std::atomic<std::size_t>, (std::size_t)GLMemoryCategory::COUNT> m_usage;
+    std::atomic<std::size_t> m_totalUsage;
+    std::size_t m_budget;
+
+    std::mutex m_evictorsMutex;
+    std::vector<Evictor> m_evictors;
+};
+
+} // namespace Vitrae
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Vitrae/Data/Typedefs.hpp"
+
+#include "glad/glad.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace Vitrae
+{
+
+struct GLCapabilities;
+
+/**
+ * @brief Which of a program's explicitly placed inputs survived linking
+ */
+struct GLActiveProgramInterface
+{
+    std::vector<GLint> uniformLocations;
+    std::vector<GLint> uniformBlockBindings;
+    std::vector<GLint> storageBlockBindings;
+
+    /**
+     * @returns the locations and bindings of the inputs that survived linking,
+     * enumerated without any name lookups
+     */
+    static GLActiveProgramInterface query(GLuint program);
+};
+
+/**
+ * @brief On-disk store of linked program binaries, keyed by the program sources and the driver
+ * @note Entries from another driver, for other sources with the same name, or that fail
+ * validation, are treated as misses
+ */
+class GLProgramBinaryCache
+{
+  public:
+    struct Key
+    {
+        // file name of the entry
+        String name;
+
+        // checked on load, so sources whose names collide don't share a binary
+        std::uint64_t sourceHash;
+        std::uint64_t sourceLength;
+    };
+
+    struct Entry
+    {
+        GLenum binaryFormat;
+        std::vector<char> binary;
+
+        GLActiveProgramInterface activeInterface;
+    };
+
+    GLProgramBinaryCache();
+
+    /**
+     * @brief Enables the cache in the given directory, if the driver supports program binaries
+     * @param directory where the entries are stored; an empty path leaves the cache disabled
+     */
+    void setup(const std::filesystem::path &directory, const GLCapabilities &caps);
+    bool isEnabled() const;
+
+    /**
+     * @returns the key of a program with the given per-stage sources
+     */
+    Key computeKey(std::span<const String> stageSources) const;
+
+    std::optional<Entry> load(const Key &key) const;
+    void store(const Key &key, const Entry &entry) const;
+
+  protected:
+    std::filesystem::path m_directory;
+    String m_driverId;
+    bool m_enabled;
+};
+
+} // namespace Vitrae
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Vitrae/Containers/StableMap.hpp"
+#include "Vitrae/Data/StringId.hpp"
+#include "Vitrae/Data/Typedefs.hpp"
+
+#include <cstddef>
+
+namespace Vitrae
+{
+
+/**
+ * @brief Param values baked into a program as constants, instead of being set as uniforms
+ */
+struct GLProgramSpecialization
+{
+    // GLSL literals of the values, by param name
+    StableMap<StringId, String> constantLiterals;
+
+    // identifies the values; 0 when nothing is specialized
+    std::size_t hash = 0;
+};
+
+} // namespace Vitrae
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "Vitrae/Data/Typedefs.hpp"
+
+#include "glad/glad.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace Vitrae
+{
+
+/**
+ * @brief CPU-side counts of the work submitted by a compose task
+ */
+struct GLTaskCounters
+{
+    std::uint64_t draws = 0;
+    std::uint64_t triangles = 0;
+    std::uint64_t dispatches = 0;
+    std::uint64_t programSwitches = 0;
+    std::uint64_t materialSwitches = 0;
+    std::uint64_t uniformUploads = 0;
+    std::uint64_t textureBinds = 0;
+    std::uint64_t bufferMaps = 0;
+
+    GLTaskCounters &operator+=(const GLTaskCounters &o);
+};
+
+/**
+ * @brief GPU-side counts from ARB_pipeline_statistics_query
+ */
+struct GLPipelineStatistics
+{
+    std::uint64_t verticesSubmitted = 0;
+    std::uint64_t vertexShaderInvocations = 0;
+    std::uint64_t fragmentShaderInvocations = 0;
+    std::uint64_t computeShaderInvocations = 0;
+
+    GLPipelineStatistics &operator+=(const GLPipelineStatistics &o);
+};
+
+/**
+ * @brief Per-task work counters, gathered per frame
+ * @note Counting is allocation-free. Snapshots get published numFramesInFlight frames late,
+ * so the pipeline statistics queries never stall the CPU.
+ */
+class GLRenderStats
+{
+  public:
+    static constexpr std::size_t MAX_TASKS_PER_FRAME = 64;
+
+    struct TaskSnapshot
+    {
+        // the friendly name of the task; valid while the task exists
+        StringView name;
+        GLTaskCounters counters;
+        GLPipelineStatistics pipelineStatistics;
+    };
+
+    struct FrameSnapshot
+    {
+        std::array<TaskSnapshot, MAX_TASKS_PER_FRAME> tasks;
+        std::size_t numTasks = 0;
+        // whether the pipelineStatistics were gathered
+        bool hasPipelineStatistics = false;
+
+        GLTaskCounters totalCounters() const;
+        GLPipelineStatistics totalPipelineStatistics() const;
+        void print(std::ostream &out) const;
+    };
+
+    /**
+     * @brief RAII attribution of the counted work to a task
+     */
+    class TaskScope
+    {
+      public:
+        TaskScope(GLRenderStats &stats, StringView name);
+        ~TaskScope();
+
+        TaskScope(const TaskScope &) = delete;
+        TaskScope &operator=(const TaskScope &) = delete;
+
+      private:
+        GLRenderStats &m_stats;
+        GLTaskCounters *mp_prevCounters;
+        std::size_t m_taskIndex;
+        std::size_t m_frameSerial;
+        bool m_queriesActive;
+    };
+
+    GLRenderStats(std::size_t numFramesInFlight);
+    ~GLRenderStats();
+
+    /**
+     * @brief Makes the calling thread the owner, and sets up pipeline statistics queries
+     * on the current context if enabled
+     */
+    void setup(bool pipelineStatistics);
+    void free();
+
+    /**
+     * @brief Publishes the oldest frame in flight and starts a new frame
+     */
+    void nextFrame();
+
+    const FrameSnapshot &getLastSnapshot() const;
+
+    /**
+     * @returns the counters of the task running on this thread,
+     * or a scratch object if no task is being counted
+     */
+    static GLTaskCounters &currentCounters();
+
+  protected:
+    static constexpr std::size_t NO_TASK = MAX_TASKS_PER_FRAME;
+    static constexpr std::size_t NUM_PIPELINE_QUERIES = 4;
+    static constexpr GLenum PIPELINE_QUERY_TARGETS[NUM_PIPELINE_QUERIES] = {
+        GL_VERTICES_SUBMITTED,
+        GL_VERTEX_SHADER_INVOCATIONS,
+        GL_FRAGMENT_SHADER_INVOCATIONS,
+        GL_COMPUTE_SHADER_INVOCATIONS,
+    };
+
+    struct Frame
+    {
+        FrameSnapshot snapshot;
+        std::vector<GLuint> queries;
+        // tasks that have all of their queries issued
+        std::array<bool, MAX_TASKS_PER_FRAME> queriesIssued;
+    };
+
+    std::vector<Frame> m_frames;
+    std::size_t m_currentFrameIndex;
+    std::size_t m_frameSerial;
+    std::size_t m_numActiveTasks;
+    std::thread::id m_ownerThreadId;
+    bool m_pipelineStatistics;
+
+    FrameSnapshot m_lastSnapshot;
+};
+
+} // namespace Vitrae
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "Vitrae/Data/Typedefs.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Vitrae
+{
+
+enum class GLShaderArtifactLevel {
+    // Artifacts don't even get generated
+    Off,
+    // The latest artifacts are kept in memory, for inspection from the application
+    Ring,
+    // Artifacts get written to files from a background thread
+    AsyncFile,
+};
+
+struct GLShaderArtifact
+{
+    // file name of the artifact, such as "vert_<pipeline id>.glsl"
+    String name;
+    String content;
+};
+
+/**
+ * @brief Receives the generated GLSL code and pipeline graphs of programs, for debugging
+ * @note Set as a ComponentRoot component; submit() can be called from any thread
+ */
+class GLShaderArtifactSink
+{
+  public:
+    virtual ~GLShaderArtifactSink() = default;
+
+    /**
+     * @returns whether artifacts should be generated and submitted at all
+     */
+    virtual bool isEnabled() const = 0;
+
+    /**
+     * @brief Takes an artifact, without blocking on I/O
+     */
+    virtual void submit(GLShaderArtifact &&artifact) = 0;
+};
+
+/**
+ * @brief Discards everything; the default, so production builds do no filesystem I/O
+ */
+class GLShaderArtifactDiscarder : public GLShaderArtifactSink
+{
+  public:
+    bool isEnabled() const override;
+    void submit(GLShaderArtifact &&artifact) override;
+};
+
+/**
+ * @brief Keeps the latest artifacts in memory
+ */
+class GLShaderArtifactRing : public GLShaderArtifactSink
+{
+  public:
+    GLShaderArtifactRing(std::size_t capacity);
+
+    bool isEnabled() const override;
+    void submit(GLShaderArtifact &&artifact) override;
+
+    /**
+     * @returns the kept artifacts, oldest first
+     */
+    std::vector<GLShaderArtifact> getArtifacts() const;
+
+  protected:
+    std::size_t m_capacity;
+
+    mutable std::mutex m_mutex;
+    std::deque<GLShaderArtifact> m_artifacts;
+};
+
+/**
+ * @brief Writes artifacts into a directory from a background thread, in batches
+ * @note Files are gzip compressed when built with zlib and compression is requested
+ */
+class GLShaderArtifactFileWriter : public GLShaderArtifactSink
+{
+  public:
+    struct SetupParams
+    {
+        std::filesystem::path directory = "shaderdebug";
+
+        // how long submitted artifacts may wait to be written
+        std::chrono::milliseconds flushInterval = std::chrono::milliseconds(500);
+
+        // a batch gets written early when it reaches this many artifacts
+        std::size_t maxBatchSize = 64;
+
+        bool compress = false;
+    };
+
+    GLShaderArtifactFileWriter(const SetupParams &params);
+    ~GLShaderArtifactFileWriter();
+
+    bool isEnabled() const override;
+    void submit(GLShaderArtifact &&artifact) override;
+
+    /**
+     * @brief Blocks until all artifacts submitted so far are written
+     */
+    void flush();
+
+  protected:
+    SetupParams m_params;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeCondition;
+    std::condition_variable m_writtenCondition;
+    std::vector<GLShaderArtifact> m_queue;
+    std::size_t m_numSubmitted;
+    std::size_t m_numWritten;
+    bool m_flushRequested;
+    bool m_stopping;
+    std::thread m_writerThread;
+
+    void writeBatch(const std::vector<GLShaderArtifact> &batch) const;
+};
+
+} // namespace Vitrae
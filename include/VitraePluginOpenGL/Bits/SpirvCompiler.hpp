@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Vitrae/Data/Typedefs.hpp"
+
+#include "glad/glad.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Vitrae
+{
+
+using GLSpirvModule = std::vector<std::uint32_t>;
+
+/**
+ * @brief Offline GLSL to SPIR-V compilation, for loading with glShaderBinary
+ * @note Only available when built with VITRAE_PLUGIN_OPENGL_ENABLE_SPIRV; thread-safe
+ */
+class GLSpirvCompiler
+{
+  public:
+    static bool isAvailable();
+
+    /**
+     * @brief Compiles one GLSL stage, targeting OpenGL
+     * @throws std::runtime_error with the compiler log if the source doesn't compile
+     */
+    static GLSpirvModule compile(GLenum shaderType, const String &glslSource);
+};
+
+/**
+ * @brief Compiled SPIR-V modules, keyed by their GLSL source, optionally persisted on disk
+ * @note The modules don't depend on the driver, so one entry serves every GPU
+ */
+class GLSpirvModuleCache
+{
+  public:
+    GLSpirvModuleCache();
+
+    /**
+     * @param directory where the modules are stored; an empty path keeps them in memory only
+     */
+    void setup(const std::filesystem::path &directory);
+
+    /**
+     * @returns the module of the source, compiling it on a miss
+     * @throws std::runtime_error if the source doesn't compile
+     */
+    std::shared_ptr<const GLSpirvModule> getModule(GLenum shaderType, const String &glslSource);
+
+  protected:
+    std::filesystem::path m_directory;
+
+    std::mutex m_mutex;
+    std::unordered_map<String, std::shared_ptr<const GLSpirvModule>> m_modules;
+
+    std::shared_ptr<const GLSpirvModule> load(const String &key) const;
+    void store(const String &key, const GLSpirvModule &module) const;
+};
+
+} // namespace Vitrae
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "glad/glad.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace Vitrae
+{
+
+/**
+ * @brief Shadow copy of one GL context's state, which filters out calls that wouldn't change it
+ * @note Every state change that passes through the cache has to be made through it,
+ * or the cache has to be invalidated afterwards
+ */
+class GLStateCache
+{
+  public:
+    struct Stats
+    {
+        std::size_t issuedCalls = 0;
+        std::size_t skippedCalls = 0;
+    };
+
+    /**
+     * @param group all caches whose contexts share objects, including this one
+     */
+    GLStateCache(const std::deque<GLStateCache> &group);
+    GLStateCache(const GLStateCache &) = delete;
+
+    /**
+     * @returns the cache of the context enabled on this thread
+     */
+    static GLStateCache &current();
+
+    /**
+     * @returns the cache of the context enabled on this thread, or nullptr if there is none;
+     * for destructors and other paths that mustn't throw
+     */
+    static GLStateCache *tryCurrent() noexcept;
+
+    static void setCurrent(GLStateCache *p_cache);
+
+    // Object bindings
+
+    void useProgram(GLuint program);
+    void bindProgramPipeline(GLuint pipeline);
+    void activeShaderProgram(GLuint pipeline, GLuint program);
+    void bindVertexArray(GLuint vertexArray);
+    void bindTextureUnit(GLuint unit, GLuint texture);
+    void bindBuffer(GLenum target, GLuint buffer);
+    void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    void bindFramebuffer(GLuint framebuffer);
+
+    // Fixed function state
+
+    void setCapability(GLenum capability, bool enabled);
+    void depthFunc(GLenum func);
+    void depthMask(bool enabled);
+    void cullFace(GLenum mode);
+    void blendEquationSeparate(GLenum modeRGB, GLenum modeAlpha);
+    void blendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha);
+    void lineWidth(GLfloat width);
+    void polygonMode(GLenum mode);
+    void hint(GLenum target, GLenum mode);
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+    // Object deletion. Callable from any thread, affects all caches of the group.
+    // Call them before the glDelete*, so a name reused right after can't match stale state
+
+    void forgetProgram(GLuint program);
+    void forgetProgramPipeline(GLuint pipeline);
+    void forgetVertexArray(GLuint vertexArray);
+    void forgetTexture(GLuint texture);
+    void forgetBuffer(GLuint buffer);
+    void forgetFramebuffer(GLuint framebuffer);
+
+    /**
+     * @brief Marks the whole state as unknown, for after untracked GL calls
+     */
+    void invalidate();
+
+    /**
+     * @note Callable from any thread
+     */
+    Stats getStats() const;
+    void resetStats();
+
+  protected:
+    enum class ObjectKind {
+        Program,
+        ProgramPipeline,
+        VertexArray,
+        Texture,
+        Buffer,
+        Framebuffer,
+    };
+
+    const std::deque<GLStateCache> &m_group;
+
+    // written only by the thread owning the context, but read from others
+    std::atomic<std::size_t> m_issuedCalls = 0;
+    std::atomic<std::size_t> m_skippedCalls = 0;
+
+    std::optional<GLuint> m_program;
+    std::optional<GLuint> m_programPipeline;
+    // state of the pipeline object, so only the last set pair is known
+    std::optional<std::pair<GLuint, GLuint>> m_activeShaderProgram;
+    std::optional<GLuint> m_vertexArray;
+    std::optional<GLuint> m_framebuffer;
+    std::vector<std::optional<GLuint>> m_textureUnits;
+    std::vector<std::pair<GLenum, std::optional<GLuint>>> m_bufferTargets;
+    std::vector<std::pair<GLenum, std::vector<std::optional<GLuint>>>> m_indexedBufferTargets;
+
+    std::vector<std::pair<GLenum, bool>> m_capabilities;
+    std::vector<std::pair<GLenum, GLenum>> m_hints;
+    std::optional<GLenum> m_depthFunc;
+    std::optional<bool> m_depthMask;
+    std::optional<GLenum> m_cullFace;
+    std::optional<std::pair<GLenum, GLenum>> m_blendEquation;
+    std::optional<std::array<GLenum, 4>> m_blendFunc;
+    std::optional<GLfloat> m_lineWidth;
+    std::optional<GLenum> m_polygonMode;
+    std::optional<std::array<GLint, 4>> m_viewport;
+
+    // deletions from other threads, applied before the next tracked call
+    std::mutex m_forgottenMutex;
+    std::atomic<bool> m_hasForgotten = false;
+    std::vector<std::pair<ObjectKind, GLuint>> m_forgotten;
+    // whether too many got queued, so they were dropped in favor of invalidating everything
+    bool m_forgottenOverflow = false;
+
+    void queueForget(ObjectKind kind, GLuint name);
+    void forgetForAll(ObjectKind kind, GLuint name);
+    void applyForgotten();
+
+    template <class T> bool changes(std::optional<T> &cached, const T &newValue);
+
+    // single writer, so no read-modify-write is needed
+    static inline void increment(std::atomic<std::size_t> &counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+};
+
+} // namespace Vitrae
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Vitrae
+{
+
+/**
+ * @brief Fixed set of threads running CPU-only jobs, such as GLSL generation
+ * @note Jobs must not use GL; with no threads, submitted jobs run in place
+ */
+class GLTaskPool
+{
+  public:
+    GLTaskPool();
+    ~GLTaskPool();
+
+    void setup(std::size_t numThreads);
+
+    /**
+     * @brief Waits for the queued jobs and stops the threads
+     */
+    void free();
+
+    std::size_t getNumThreads() const;
+
+    template <class F> std::future<std::invoke_result_t<F>> submit(F &&job)
+    {
+        using Result = std::invoke_result_t<F>;
+
+        auto p_task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+        std::future<Result> future = p_task->get_future();
+
+        if (m_threads.empty()) {
+            (*p_task)();
+        } else {
+            enqueue([p_task]() { (*p_task)(); });
+        }
+        return future;
+    }
+
+  protected:
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCondition;
+    std::deque<std::function<void()>> m_queue;
+    bool m_stopping;
+
+    void enqueue(std::function<void()> job);
+};
+
+} // namespace Vitrae
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Vitrae/Data/Typedefs.hpp"
+
+#include <cstddef>
+#include <ostream>
+#include <span>
+#include <vector>
+
+namespace Vitrae
+{
+
+/**
+ * @brief GLSL code split at the identifiers of its params, so they can be replaced while writing
+ * it out, without #define/#undef pairs around it
+ * @note Identifiers inside comments are left alone, like the preprocessor would. Preprocessor
+ * directives are left as written; the params they mention get #defined around the code instead
+ */
+class GLTokenizedCode
+{
+  public:
+    GLTokenizedCode() = default;
+
+    /**
+     * @param paramNames the identifiers that get replaced; a param's index selects its
+     * replacement in write()
+     */
+    GLTokenizedCode(String code, std::span<const String> paramNames);
+
+    inline const String &getCode() const { return m_code; }
+
+    /**
+     * @brief Writes the code with each param identifier replaced by replacements[paramIndex]
+     */
+    void write(std::ostream &output, std::span<const String> replacements) const;
+
+  protected:
+    struct Segment
+    {
+        std::size_t offset;
+        std::size_t length;
+
+        // index of the param, or -1 for code that gets written as is
+        std::ptrdiff_t paramIndex;
+    };
+
+    String m_code;
+    std::vector<Segment> m_segments;
+
+    // params mentioned in preprocessor directives
+    std::vector<std::ptrdiff_t> m_directiveParamIndices;
+    std::vector<String> m_directiveParamNames;
+};
+
+} // namespace Vitrae
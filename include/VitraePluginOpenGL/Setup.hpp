@@ -1,10 +1,11 @@
 #pragma once
 
 #include "Vitrae/Collections/ComponentRoot.hpp"
+#include "VitraePluginOpenGL/Specializations/Renderer.hpp"
 
 namespace VitraePluginOpenGL
 {
 
-void setup(Vitrae::ComponentRoot &root);
+void setup(Vitrae::ComponentRoot &root, const Vitrae::OpenGLRenderer::SetupParams &params = {});
 
 }
\ No newline at end of file
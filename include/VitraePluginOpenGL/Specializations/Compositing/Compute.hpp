@@ -3,6 +3,8 @@
 #include "Vitrae/Dynamic/VariantScope.hpp"
 #include "Vitrae/Pipelines/Compositing/Compute.hpp"
 
+#include "glm/glm.hpp"
+
 #include <functional>
 #include <vector>
 
@@ -11,6 +13,8 @@ namespace Vitrae
 
 class OpenGLRenderer;
 class ParamList;
+class CompiledGLSLShaderWarmUp;
+struct GLCapabilities;
 
 class OpenGLComposeCompute : public ComposeCompute {
   public:
@@ -33,6 +37,13 @@ class OpenGLComposeCompute : public ComposeCompute {
 
     StringView getFriendlyName() const override;
 
+    /**
+     * @brief Queues the program of the task to the warm-up
+     * @note Skipped when the group size depends on properties known only when running.
+     * The aliases must outlive the warm-up.
+     */
+    void warmUp(CompiledGLSLShaderWarmUp &warmUp, const ParamAliases &aliases) const;
+
   protected:
     SetupParams m_params;
     String m_friendlyName;
@@ -49,6 +60,12 @@ class OpenGLComposeCompute : public ComposeCompute {
     mutable StableMap<std::size_t, std::unique_ptr<ProgramPerAliases>> m_programPerAliasHash;
 
     ProgramPerAliases &getProgramPerAliases(const ParamAliases &aliases) const;
+
+    /**
+     * @returns the group size to compile with, with auto sizes replaced by the implementation's
+     * @throws std::runtime_error if the group size exceeds the implementation limits
+     */
+    static glm::ivec3 decideGroupSize(glm::ivec3 specifiedGroupSize, const GLCapabilities &caps);
 };
 
 } // namespace Vitrae
\ No newline at end of file
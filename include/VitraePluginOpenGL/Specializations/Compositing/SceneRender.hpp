@@ -10,6 +10,11 @@ namespace Vitrae
 {
 
 class OpenGLRenderer;
+class CompiledGLSLShader;
+class CompiledGLSLShaderWarmUp;
+class Scene;
+class FrameStore;
+class Material;
 
 class OpenGLComposeSceneRender : public ComposeSceneRender
 {
@@ -33,6 +38,15 @@ class OpenGLComposeSceneRender : public ComposeSceneRender
 
     StringView getFriendlyName() const override;
 
+    /**
+     * @brief Queues the programs of the scene's materials for the frame to the warm-up
+     * @note Their inputs get registered as they become ready, so the first run with the same
+     * aliases doesn't have to request a pipeline rebuild.
+     * The scene, frame and aliases must outlive the warm-up.
+     */
+    void warmUp(CompiledGLSLShaderWarmUp &warmUp, const Scene &scene, const FrameStore &frame,
+                const ParamAliases &aliases) const;
+
   protected:
     ComponentRoot &m_root;
 
@@ -48,6 +62,14 @@ class OpenGLComposeSceneRender : public ComposeSceneRender
     mutable StableMap<std::size_t, std::unique_ptr<SpecsPerAliases>> m_specsPerKey;
 
     std::size_t getSpecsKey(const ParamAliases &aliases) const;
+    SpecsPerAliases &getSpecsPerAliases(const ParamAliases &aliases) const;
+
+    /**
+     * @brief Adds the inputs of the shader not provided by the material
+     * @returns whether any were missing
+     */
+    bool mergeShaderSpecs(SpecsPerAliases &specsContainer, const CompiledGLSLShader &shader,
+                          const Material &material) const;
 };
 
 } // namespace Vitrae
\ No newline at end of file
@@ -28,11 +28,7 @@ class OpenGLMesh : public Mesh
 
     BoundingBox getBoundingBox() const override;
 
-    inline std::size_t memory_cost() const override
-    {
-        /// TODO: compute the real cost
-        return sizeof(*this);
-    }
+    std::size_t memory_cost() const override;
 
     SharedSubBufferVariantPtr getVertexComponentBuffer(StringId componentName) const override;
     void setVertexComponentBuffer(StringId componentName,
@@ -1,20 +1,44 @@
 #pragma once
 
 #include "Vitrae/Assets/BufferUtil/Ptr.hpp"
+#include "Vitrae/Assets/Material.hpp"
 #include "Vitrae/Data/StringId.hpp"
 #include "Vitrae/Renderer.hpp"
+#include "VitraePluginOpenGL/Bits/Capabilities.hpp"
+#include "VitraePluginOpenGL/Bits/CommandBuffer.hpp"
+#include "VitraePluginOpenGL/Bits/DebugAggregator.hpp"
+#include "VitraePluginOpenGL/Bits/GpuTimer.hpp"
+#include "VitraePluginOpenGL/Bits/MemoryLedger.hpp"
+#include "VitraePluginOpenGL/Bits/ProgramBinaryCache.hpp"
+#include "VitraePluginOpenGL/Bits/ProgramSpecialization.hpp"
+#include "VitraePluginOpenGL/Bits/RenderStats.hpp"
+#include "VitraePluginOpenGL/Bits/ShaderArtifacts.hpp"
+#include "VitraePluginOpenGL/Bits/SpirvCompiler.hpp"
+#include "VitraePluginOpenGL/Bits/StateCache.hpp"
+#include "VitraePluginOpenGL/Bits/TaskPool.hpp"
 
 #include "glad/glad.h"
 // must be after glad.h
 #include "GLFW/glfw3.h"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
 #include <deque>
+#include <filesystem>
 #include <functional>
+#include <future>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <set>
 #include <thread>
 #include <typeindex>
+#include <unordered_map>
 #include <vector>
 
 namespace Vitrae
@@ -23,6 +47,9 @@ class Mesh;
 class Texture;
 class RawSharedBuffer;
 class ComposeTask;
+class CompiledGLSLShaderPrebuilds;
+class CompiledGLSLProgramRegistry;
+class CompiledGLSLPipelineMemo;
 
 struct GLLayoutSpec
 {
@@ -71,7 +98,8 @@ struct GLConversionSpec
 
     std::optional<GLScalarSpec> scalarSpec;
 
-    std::function<void(GLint location, const Variant &hostValue)>   setUniform       = nullptr;
+    // plain function pointer, since uniform setters never need state and are called per draw
+    void (*setUniform)(GLint location, const Variant &hostValue)                     = nullptr;
     std::function<void(int bindingIndex, const Variant &hostValue)> setOpaqueBinding = nullptr;
     std::function<void(int bindingIndex, const Variant &hostValue)> setUBOBinding    = nullptr;
     std::function<void(int bindingIndex, const Variant &hostValue)> setSSBOBinding   = nullptr;
@@ -85,10 +113,152 @@ struct GLSpecificationError : public std::invalid_argument
     using std::invalid_argument::invalid_argument;
 };
 
+/**
+ * @brief How the main GL context gets created
+ */
+enum class GLContextMode {
+    // A normal GLFW window, usable for WindowDisplayParams FrameStores
+    Windowed,
+    // A 4.6 core context through EGL, without any display server
+    HeadlessEGL,
+    // A 4.6 core context through OSMesa (llvmpipe), without any display server or GPU
+    HeadlessOSMesa,
+};
+
+/**
+ * @brief How GL errors and debug messages get reported
+ */
+enum class GLDiagnosticLevel {
+    // No debug context; KHR_no_error where available, so invalid calls are undefined behavior
+    Production,
+    // Messages get counted per id and summarized periodically from a background thread
+    Aggregated,
+    // Every message gets written to the error stream as it arrives
+    Verbose,
+};
+
+enum class GLPendingProgramPolicy {
+    // Programs get compiled and linked when first requested, stalling the render thread
+    Wait,
+    // Draws using a program that's still compiling get skipped
+    Skip,
+    // Draws using a program that's still compiling use the fallback material instead
+    Fallback,
+};
+
 class OpenGLRenderer : public Renderer
 {
   public:
+    struct SetupParams
+    {
+        GLContextMode contextMode = GLContextMode::Windowed;
+
+        /**
+         * Number of contexts shared with the main one,
+         * used by non-main threads between anyThreadEnable() and anyThreadDisable().
+         * Threads fall back to locking the main context when all of them are taken.
+         */
+        std::size_t numWorkerContexts = 0;
+
+        GLDiagnosticLevel diagnosticLevel = GLDiagnosticLevel::Verbose;
+
+        /**
+         * How often the aggregated debug messages get reported
+         */
+        std::chrono::milliseconds debugFlushInterval = std::chrono::seconds(1);
+
+        /**
+         * Whether compose tasks get timed on the GPU with timestamp queries.
+         * Results arrive gpuTimingFramesInFlight frames late, without stalling the pipeline.
+         */
+        bool gpuTiming = false;
+        std::size_t gpuTimingFramesInFlight = 4;
+        std::size_t gpuTimingMaxScopesPerFrame = 256;
+
+        /**
+         * Whether ARB_pipeline_statistics_query results get gathered per compose task,
+         * in addition to the always-on CPU counters
+         */
+        bool pipelineStatistics = false;
+
+        /**
+         * Video memory that GL assets may take before caches start evicting, in bytes.
+         * If 0, it's derived from the dedicated video memory when the driver reports it.
+         */
+        std::size_t vramBudget = 0;
+
+        /**
+         * Directory where linked program binaries get cached between runs.
+         * If empty, or if the driver doesn't support program binaries, programs always get
+         * compiled from source.
+         */
+        std::filesystem::path programBinaryCacheDir;
+
+        /**
+         * What scene renders do with programs that aren't ready yet.
+         * Anything but Wait compiles programs in the background, with KHR_parallel_shader_compile
+         * or on a worker context, falling back to compiling in place when neither is available.
+         */
+        GLPendingProgramPolicy pendingProgramPolicy = GLPendingProgramPolicy::Wait;
+
+        /**
+         * Number of threads generating GLSL code for programs requested ahead of time.
+         * If 0, the code is always generated on the thread requesting the program.
+         */
+        std::size_t numShaderBuildThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+        /**
+         * Whether programs get compiled to SPIR-V and loaded with glShaderBinary.
+         * Requires building with VITRAE_PLUGIN_OPENGL_ENABLE_SPIRV and GL 4.6 or ARB_gl_spirv;
+         * otherwise programs get compiled from GLSL.
+         * Compute group sizes become specialization constants, so one module serves all of them.
+         */
+        bool spirvPrograms = false;
+
+        /**
+         * Whether the stages of surface programs get compiled and cached separately,
+         * and combined with program pipeline objects.
+         * Materials sharing a vertex stage then share its compile, at the cost of uploading
+         * uniforms used by several stages once per stage.
+         * Requires GL 4.1 or ARB_separate_shader_objects.
+         */
+        bool separablePrograms = false;
+
+        /**
+         * Directory where compiled SPIR-V modules get cached between runs.
+         * If empty, modules are only kept in memory.
+         */
+        std::filesystem::path spirvModuleCacheDir;
+
+        /**
+         * How many solved shader pipelines are kept for reuse by later program builds.
+         * Each keeps its method alive; the least recently used ones get dropped first.
+         */
+        std::size_t maxMemoizedPipelines = 1024;
+
+        /**
+         * Names of material properties whose values get baked into programs as constants,
+         * so the driver can fold them and they never get uploaded.
+         * Only float, int and uint scalar and vector properties that would otherwise be plain
+         * uniforms get baked. Each distinct combination of values makes a separate program;
+         * once there are maxSpecializedVariants combinations, a new one replaces one that wasn't
+         * requested during the last frame, or keeps using uniforms if there is none.
+         */
+        std::vector<String> staticMaterialProperties;
+        std::size_t maxSpecializedVariants = 64;
+
+        /**
+         * Where the generated GLSL code and pipeline graphs go.
+         * Used to pick the GLShaderArtifactSink component during setup;
+         * the component can be replaced on the ComponentRoot afterwards.
+         */
+        GLShaderArtifactLevel shaderArtifactLevel = GLShaderArtifactLevel::Off;
+        std::size_t shaderArtifactRingCapacity = 64;
+        GLShaderArtifactFileWriter::SetupParams shaderArtifactFiles;
+    };
+
     OpenGLRenderer(ComponentRoot &root);
+    OpenGLRenderer(ComponentRoot &root, const SetupParams &params);
     ~OpenGLRenderer();
 
     void mainThreadSetup(ComponentRoot &root) override;
@@ -100,6 +270,133 @@ class OpenGLRenderer : public Renderer
 
     GLFWwindow *getWindow();
 
+    const SetupParams &getParams() const;
+
+    /**
+     * @brief Sets the material drawn in place of materials whose programs are still compiling
+     * @note Used with GLPendingProgramPolicy::Fallback; without it, such draws get skipped
+     */
+    void setFallbackMaterial(dynasma::FirmPtr<const Material> p_material);
+    const std::optional<dynasma::FirmPtr<const Material>> &getFallbackMaterial() const;
+
+    /**
+     * @returns the limits and features of the GL implementation
+     * @note Valid after mainThreadSetup()
+     */
+    const GLCapabilities &getCapabilities() const;
+
+    /**
+     * @returns the GPU timer of the main context, disabled unless SetupParams::gpuTiming is set
+     */
+    GLGpuTimer &getGpuTimer();
+
+    /**
+     * @returns the per-task work counters of the main context
+     */
+    GLRenderStats &getRenderStats();
+
+    /**
+     * @returns the tally of video memory held by GL assets
+     */
+    GLMemoryLedger &getMemoryLedger();
+
+    /**
+     * @returns the on-disk cache of linked programs, disabled unless
+     * SetupParams::programBinaryCacheDir is set
+     */
+    const GLProgramBinaryCache &getProgramBinaryCache() const;
+
+    /**
+     * @returns the threads that generate GLSL code, sized by SetupParams::numShaderBuildThreads
+     */
+    GLTaskPool &getShaderBuildPool();
+
+    /**
+     * @brief Queues a job that uses GL on one of the worker contexts. At most one job runs per
+     * worker context, and jobs wait for a free one instead of falling back to the main context
+     * @note Requires getNumWorkerContexts() > 0
+     */
+    std::future<void> runOnWorkerContext(std::function<void()> job);
+
+    /**
+     * @returns whether programs get loaded as SPIR-V, as requested by SetupParams::spirvPrograms
+     * and supported by the build and the driver
+     * @note Valid after mainThreadSetup()
+     */
+    bool usesSpirvPrograms() const;
+
+    /**
+     * @returns whether surface programs are made of separable stage programs,
+     * as requested by SetupParams::separablePrograms and supported by the driver
+     * @note Valid after mainThreadSetup()
+     */
+    bool usesSeparablePrograms() const;
+
+    /**
+     * @returns the compiled SPIR-V modules, shared by all programs with the same stage source
+     */
+    GLSpirvModuleCache &getSpirvModuleCache();
+
+    /**
+     * @returns the GLSL builds started ahead of time, waiting for their programs to be created
+     */
+    CompiledGLSLShaderPrebuilds &getShaderPrebuilds();
+
+    /**
+     * @returns the GL programs of the live shaders by their sources, with deduplication stats
+     */
+    CompiledGLSLProgramRegistry &getProgramRegistry();
+
+    /**
+     * @returns the solved shader pipelines, shared by all stages and variants, with hit stats
+     */
+    CompiledGLSLPipelineMemo &getPipelineMemo();
+
+    /**
+     * @returns the values of the material's static properties to bake into its programs;
+     * nothing if it has none or the variant budget is used up by variants requested recently
+     * @note Only float, int and uint scalars and vectors get baked. The result is remembered per
+     * material, and only formatted again when the values change
+     */
+    std::shared_ptr<const GLProgramSpecialization> getMaterialSpecialization(
+        const Material &material);
+
+    /**
+     * @returns whether the context has no displayable window,
+     * so only texture-bound FrameStores can be rendered to
+     */
+    bool isHeadless() const;
+
+    /**
+     * @returns the number of shared contexts that were actually created
+     */
+    std::size_t getNumWorkerContexts() const;
+
+    /**
+     * @brief Queues recorded GL commands to be replayed on the main thread
+     * during the next mainThreadUpdate()
+     * @note Lock-free; callable from any thread without enabling the context
+     */
+    void submitCommands(GLCommandBuffer &&buffer);
+
+    /**
+     * @brief Replays the submitted commands now instead of in the next mainThreadUpdate(),
+     * for work that depends on them
+     * @note Has to be called on the main thread
+     */
+    void replaySubmittedCommands();
+
+    /**
+     * @returns the state cache of the main context
+     * @note GLStateCache::current() returns the cache of whichever context the thread has enabled
+     */
+    GLStateCache &getMainStateCache();
+
+    /**
+     * @returns the issued and skipped state calls, summed over all contexts
+     */
+    GLStateCache::Stats getStateCacheStats() const;
+
     /**
      * @brief Register needed GL info about a type automagically using TypeMeta
      */
@@ -132,10 +429,82 @@ class OpenGLRenderer : public Renderer
 
   protected:
     ComponentRoot &m_root;
+    SetupParams m_params;
 
     std::thread::id m_mainThreadId;
     std::mutex m_contextMutex;
     GLFWwindow *mp_mainWindow;
+    GLCapabilities m_capabilities;
+    std::unique_ptr<GLDebugAggregator> mp_debugAggregator;
+    GLGpuTimer m_gpuTimer;
+    GLRenderStats m_renderStats;
+    GLMemoryLedger m_memoryLedger;
+    GLProgramBinaryCache m_programBinaryCache;
+    GLTaskPool m_shaderBuildPool;
+    GLTaskPool m_workerContextPool;
+    bool m_usesSpirvPrograms;
+    bool m_usesSeparablePrograms;
+    GLSpirvModuleCache m_spirvModuleCache;
+    std::unique_ptr<CompiledGLSLShaderPrebuilds> mp_shaderPrebuilds;
+    std::unique_ptr<CompiledGLSLProgramRegistry> mp_programRegistry;
+    std::unique_ptr<CompiledGLSLPipelineMemo> mp_pipelineMemo;
+    std::set<StringId> m_staticMaterialPropertyIds;
+    std::mutex m_specializationMutex;
+    // the frame each specialized variant was last requested in
+    std::map<std::size_t, std::uint64_t> m_specializationLastFrames;
+    std::uint64_t m_specializationFrame = 0;
+
+    // raw components of a static property's value, to tell values apart without formatting them
+    struct StaticPropertyValue
+    {
+        const TypeInfo *p_typeInfo;
+        std::array<std::uint32_t, 4> bits;
+
+        bool operator==(const StaticPropertyValue &) const = default;
+    };
+    struct MaterialSpecialization
+    {
+        // per static property, in the order of m_staticMaterialPropertyIds
+        std::vector<std::optional<StaticPropertyValue>> values;
+        std::shared_ptr<const GLProgramSpecialization> p_specialization;
+        std::uint64_t lastFrame;
+    };
+    std::unordered_map<const Material *, MaterialSpecialization> m_materialSpecializations;
+    std::size_t m_materialSpecializationPruneSize = 64;
+    std::shared_ptr<const GLProgramSpecialization> mp_noSpecialization =
+        std::make_shared<const GLProgramSpecialization>();
+
+    bool admitSpecializedVariant(std::size_t hash);
+    std::optional<dynasma::FirmPtr<const Material>> mp_fallbackMaterial;
+
+    struct WorkerContext
+    {
+        GLFWwindow *p_window;
+        GLStateCache *p_stateCache;
+    };
+
+    std::mutex m_workerContextMutex;
+    std::condition_variable m_freeWorkerContextCondition;
+    std::vector<WorkerContext> m_workerContexts;
+    std::vector<WorkerContext> m_freeWorkerContexts;
+    std::map<std::thread::id, WorkerContext> m_workerContextsByThread;
+
+    // fences of worker contexts, in the order they were made
+    struct WorkerFence
+    {
+        std::uint64_t serial;
+        GLsync sync;
+    };
+    std::deque<WorkerFence> m_workerFences;
+    std::uint64_t m_lastWorkerFenceSerial = 0;
+
+    // per context window, the serial of the last fence that context waited for
+    std::map<GLFWwindow *, std::uint64_t> m_waitedWorkerFenceSerials;
+
+    GLCommandQueue m_commandQueue;
+
+    // one per context; the first one belongs to the main context
+    std::deque<GLStateCache> m_stateCaches;
 
     std::deque<GLTypeSpec> m_glTypes;
     std::deque<GLConversionSpec> m_glConversions;
@@ -149,6 +518,19 @@ class OpenGLRenderer : public Renderer
 
     mutable StableMap<std::size_t, StableMap<StringId, ParamSpec>> m_sceneRenderInputDependencies;
 
+    /**
+     * @brief Makes the current context wait for objects finished on worker contexts,
+     * since it last waited
+     * @param p_window the window of the current context
+     */
+    void waitForWorkerFences(GLFWwindow *p_window);
+
+    // takes one of m_freeWorkerContexts and makes it current on this thread; unlocks the lock
+    void enableFreeWorkerContext(std::unique_lock<std::mutex> &workerContextLock);
+
+    // sets up debug message reporting for the current context
+    void setupDebugOutput(ComponentRoot &root);
+
     // utility
     static void setRawBufferBinding(const RawSharedBuffer &buf, int bindingIndex);
 };
@@ -6,13 +6,31 @@
 #include "Vitrae/Params/ArgumentGetter.hpp"
 #include "Vitrae/Pipelines/Pipeline.hpp"
 #include "Vitrae/Pipelines/Shading/Task.hpp"
+#include "VitraePluginOpenGL/Bits/MemoryLedger.hpp"
+#include "VitraePluginOpenGL/Bits/ProgramBinaryCache.hpp"
+#include "VitraePluginOpenGL/Bits/ProgramSpecialization.hpp"
+#include "VitraePluginOpenGL/Bits/RenderStats.hpp"
+#include "VitraePluginOpenGL/Bits/SpirvCompiler.hpp"
+#include "VitraePluginOpenGL/Bits/StateCache.hpp"
 
 #include "dynasma/cachers/abstract.hpp"
 #include "dynasma/pointer.hpp"
 #include "glad/glad.h"
 
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <set>
+#include <span>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 
 namespace Vitrae
 {
@@ -53,11 +71,13 @@ class CompiledGLSLShader : public dynasma::PolymorphicBase
         String m_vertexPositionOutputName;
         const ParamList &m_fragmentOutputs;
         ComponentRoot *mp_root;
+        GLProgramSpecialization m_specialization;
         std::size_t m_hash;
 
       public:
         SurfaceShaderParams(const ParamAliases &aliases, String vertexPositionOutputName,
-                            const ParamList &fragmentOutputs, ComponentRoot &root);
+                            const ParamList &fragmentOutputs, ComponentRoot &root,
+                            const GLProgramSpecialization &specialization = {});
 
         inline const ParamAliases &getAliases() const { return m_aliases; }
         inline const String &getVertexPositionOutputName() const
@@ -66,6 +86,10 @@ class CompiledGLSLShader : public dynasma::PolymorphicBase
         }
         inline const ParamList &getFragmentOutputs() const { return m_fragmentOutputs; }
         inline ComponentRoot &getRoot() const { return *mp_root; }
+        inline const GLProgramSpecialization &getSpecialization() const
+        {
+            return m_specialization;
+        }
 
         inline std::size_t getHash() const { return m_hash; }
 
@@ -130,13 +154,123 @@ class CompiledGLSLShader : public dynasma::PolymorphicBase
         GLuint bindingIndex;
     };
 
+    /**
+     * @brief One uniform or binding to set up before a draw, resolved at link time
+     */
+    struct BindingPlanEntry
+    {
+        StringId nameId;
+
+        // uniform location for uniforms, binding index for the rest
+        GLint locationOrBinding;
+
+        // exactly one of these is set
+        void (*setUniform)(GLint location, const Variant &hostValue);
+        const std::function<void(int bindingIndex, const Variant &hostValue)> *p_setBinding;
+
+        // for separable programs, the stage program that receives the uniform
+        GLuint programPipelineGLName = 0;
+        GLuint stageProgramGLName = 0;
+
+        inline void apply(const Variant &hostValue) const
+        {
+            if (setUniform) {
+                if (stageProgramGLName) {
+                    GLStateCache::current().activeShaderProgram(programPipelineGLName,
+                                                                stageProgramGLName);
+                }
+                setUniform(locationOrBinding, hostValue);
+                ++GLRenderStats::currentCounters().uniformUploads;
+            } else {
+                (*p_setBinding)(locationOrBinding, hostValue);
+            }
+        }
+    };
+
+    /**
+     * @brief A uniform location within the program object that holds it
+     */
+    struct UniformTarget
+    {
+        GLuint programGLName;
+        GLint location;
+    };
+
+    /**
+     * @brief Generated GLSL code and the program interface, before anything is sent to GL
+     */
+    struct SourceBuild
+    {
+        struct Stage
+        {
+            GLenum shaderType;
+            String srcCode;
+
+            // identifies the stage in logs and debug artifacts
+            String name;
+
+            // set when the stage gets loaded as SPIR-V instead of compiled from srcCode
+            std::shared_ptr<const GLSpirvModule> p_spirvModule;
+            std::vector<GLuint> specializationIds;
+            std::vector<GLuint> specializationValues;
+        };
+
+        std::vector<Stage> stages;
+
+        ParamList inputSpecs, outputSpecs, filterSpecs, consumingSpecs;
+        ParamList vertexComponentSpecs;
+        StableMap<StringId, LocationSpec> uniformSpecs;
+        StableMap<StringId, BindingSpec> opaqueBindingSpecs;
+        StableMap<StringId, BindingSpec> uboSpecs;
+        StableMap<StringId, BindingSpec> ssboSpecs;
+
+        // vec4 locations passed between the stages, after packing
+        std::size_t numInterpolators = 0;
+    };
+
+    /**
+     * @brief Generates the GLSL code of a program
+     * @param constantLiterals GLSL literals of inputs to bake into the code instead of making
+     * them uniforms
+     * @note Doesn't need a GL context, so it can run on any thread, as long as no types or
+     * vertex buffers get specified in the meantime
+     */
+    static SourceBuild buildSources(MovableSpan<CompilationSpec> compilationSpecs,
+                                    ComponentRoot &root, const ParamList &desiredOutputs,
+                                    const StableMap<StringId, String> &constantLiterals = {});
+    static SourceBuild buildSources(const SurfaceShaderParams &params);
+    static SourceBuild buildSources(const ComputeShaderParams &params);
+
+    CompiledGLSLShader(SourceBuild &&build, ComponentRoot &root);
     CompiledGLSLShader(MovableSpan<CompilationSpec> compilationSpecs, ComponentRoot &root,
                        const ParamList &desiredOutputs);
     CompiledGLSLShader(const SurfaceShaderParams &params);
     CompiledGLSLShader(const ComputeShaderParams &params);
     ~CompiledGLSLShader();
 
-    inline std::size_t memory_cost() const { return 1; }
+    inline std::size_t memory_cost() const { return sizeof(*this) + programBinarySize; }
+
+    /**
+     * @returns whether the program has finished linking and can be used
+     * @note Never blocks; finishes the setup of the program once the link is done
+     */
+    bool isReady();
+
+    /**
+     * @brief Blocks until the program is linked and set up
+     */
+    void waitUntilReady();
+
+    /**
+     * @brief Makes the program current, or binds its program pipeline if it's separable
+     */
+    void use() const;
+
+    /**
+     * @returns where to upload the uniform with glProgramUniform*; one target per separable
+     * stage that uses it, and none if it's inactive
+     */
+    std::span<const UniformTarget> getUniformTargets(StringId nameId) const;
 
     void setupProperties(OpenGLRenderer &rend, VariantScope &env) const;
 
@@ -146,12 +280,86 @@ class CompiledGLSLShader : public dynasma::PolymorphicBase
     void setupMaterialProperties(OpenGLRenderer &rend, const Material &material) const;
 
     ParamList inputSpecs, outputSpecs, filterSpecs, consumingSpecs;
+
+    // the linked program, or 0 for separable programs, which use the pipeline instead
     GLuint programGLName;
+    GLuint programPipelineGLName;
     ParamList vertexComponentSpecs;
     StableMap<StringId, LocationSpec> uniformSpecs;
     StableMap<StringId, BindingSpec> opaqueBindingSpecs;
     StableMap<StringId, BindingSpec> uboSpecs;
     StableMap<StringId, BindingSpec> ssboSpecs;
+
+    // all of the above, flattened in setup order
+    std::vector<BindingPlanEntry> bindingPlan;
+
+    // size of the linked program as reported by the driver
+    std::size_t programBinarySize;
+
+    // vec4 locations passed between the stages, after packing
+    std::size_t numInterpolators;
+
+  protected:
+    friend class CompiledGLSLProgramRegistry;
+
+    // what's left to do after the program gets submitted for linking
+    struct PendingLink
+    {
+        std::vector<SourceBuild::Stage> stages;
+        std::vector<GLuint> shaderIds;
+
+        std::optional<GLProgramBinaryCache::Entry> cachedBinary;
+        bool linkedFromCache = false;
+
+        // whether KHR_parallel_shader_compile is doing the work
+        bool pollCompletionStatus = false;
+    };
+
+    // the GL program, shared by all shaders whose generated sources are identical
+    struct LinkedProgram
+    {
+        ComponentRoot *p_root;
+        OpenGLRenderer *p_renderer;
+        GLuint programGLName = 0;
+
+        // whether it's a single stage of a program pipeline
+        bool separable = false;
+        GLbitfield stageBits = 0;
+
+        // identifies the sources in the program binary cache
+        GLProgramBinaryCache::Key binaryKey;
+
+        std::unique_ptr<PendingLink> p_pendingLink;
+        std::future<void> workerLink;
+
+        bool linkSucceeded = false;
+        GLActiveProgramInterface activeInterface;
+        std::size_t programBinarySize = 0;
+
+        ~LinkedProgram();
+
+        void submitCompileAndLink();
+
+        /**
+         * @returns whether the link is done, finishing it if so; never blocks
+         */
+        bool pollLink();
+        void waitForLink();
+        void finishLink();
+    };
+
+    // one program, or one per stage when separable
+    std::vector<std::shared_ptr<LinkedProgram>> m_programs;
+    bool m_interfacePending;
+    StableMap<StringId, std::vector<UniformTarget>> m_uniformTargets;
+
+    // expires with the shader, so CompiledGLSLShaderPrebuilds knows its seed is no longer cached
+    std::shared_ptr<const bool> mp_seedToken;
+
+    static std::shared_ptr<LinkedProgram> obtainProgram(std::vector<SourceBuild::Stage> &&stages,
+                                                        bool separable, OpenGLRenderer &rend,
+                                                        ComponentRoot &root);
+    void resolveInterface();
 };
 
 struct CompiledGLSLShaderCacherSeed
@@ -168,4 +376,236 @@ struct CompiledGLSLShaderCacherSeed
 
 using CompiledGLSLShaderCacher = dynasma::AbstractCacher<CompiledGLSLShaderCacherSeed>;
 
+/**
+ * @brief Program objects of the live shaders, keyed by their whole generated sources,
+ * so shaders generated into identical sources share one compile and one GL program
+ * @note Thread-safe
+ */
+class CompiledGLSLProgramRegistry
+{
+  public:
+    struct Stats
+    {
+        // programs requested by shaders
+        std::size_t numRequests = 0;
+        // requests served by an existing program
+        std::size_t numDeduplicated = 0;
+        // distinct programs currently alive
+        std::size_t numPrograms = 0;
+    };
+
+    /**
+     * @returns the live program with the given sources if there is one, otherwise the candidate,
+     * which gets registered for them
+     */
+    std::shared_ptr<CompiledGLSLShader::LinkedProgram> findOrInsert(
+        const String &sources,
+        const std::shared_ptr<CompiledGLSLShader::LinkedProgram> &p_candidate);
+
+    Stats getStats() const;
+
+  protected:
+    mutable std::mutex m_mutex;
+    std::unordered_map<String, std::weak_ptr<CompiledGLSLShader::LinkedProgram>> m_programs;
+    Stats m_stats;
+};
+
+/**
+ * @brief Solved shader pipelines, reused by all stages and variants that ask the same method for
+ * the same outputs with the same aliases
+ * @note Programs that differ only in what doesn't reach the solver share their solves: material
+ * specializations baking different constants, compute group sizes, and the stages that
+ * different compose tasks ask the same of. So do programs created again after being evicted.
+ * The solver doesn't report which aliases it looked up, so the whole alias set is the key.
+ * Keeps at most maxEntries pipelines, evicting the least recently used ones; thread-safe
+ */
+class CompiledGLSLPipelineMemo
+{
+  public:
+    struct Stats
+    {
+        // pipelines requested by shader builds
+        std::size_t numRequests = 0;
+        // requests served by an already solved pipeline
+        std::size_t numHits = 0;
+        // requests that had to be solved
+        std::size_t numMisses = 0;
+        // solved pipelines dropped to stay within the entry limit
+        std::size_t numEvictions = 0;
+        // solved pipelines currently kept
+        std::size_t numEntries = 0;
+    };
+
+    CompiledGLSLPipelineMemo(std::size_t maxEntries);
+
+    /**
+     * @returns the pipeline of the method for the desired outputs, solving it on a miss
+     * @throws PipelineSetupException if the pipeline can't be solved
+     */
+    Pipeline<ShaderTask> getPipeline(dynasma::FirmPtr<const Method<ShaderTask>> p_method,
+                                     const ParamList &desiredOutputs,
+                                     const ParamAliases &aliases);
+
+    Stats getStats() const;
+
+    /**
+     * @brief Forgets all solved pipelines, such as after the methods get changed
+     */
+    void clear();
+
+  protected:
+    // the solver may look up any alias, so the whole alias set is part of the key
+    using Key = std::tuple<const Method<ShaderTask> *, std::size_t, std::size_t>;
+
+    struct Entry
+    {
+        Key key;
+
+        // keeps the method alive, so its address stays a valid key
+        dynasma::FirmPtr<const Method<ShaderTask>> p_method;
+        Pipeline<ShaderTask> pipeline;
+    };
+
+    std::size_t m_maxEntries;
+
+    mutable std::mutex m_mutex;
+    // most recently used first
+    std::list<Entry> m_entries;
+    std::map<Key, std::list<Entry>::iterator> m_entryPerKey;
+    Stats m_stats;
+};
+
+/**
+ * @brief GLSL builds started ahead of time on the renderer's build pool,
+ * picked up by the constructor of the program with the same params
+ */
+class CompiledGLSLShaderPrebuilds
+{
+  public:
+    CompiledGLSLShaderPrebuilds(OpenGLRenderer &rend);
+
+    /**
+     * @brief Starts building the sources of the program, unless already started or the program
+     * for the seed is alive
+     * @note The aliases and param lists referenced by the seed must outlive the build,
+     * or be passed to drop() first
+     */
+    void prebuild(const CompiledGLSLShaderCacherSeed &seed);
+
+    /**
+     * @returns the started build for the seed, if any, removing it from the list
+     */
+    std::optional<std::future<CompiledGLSLShader::SourceBuild>> take(
+        const CompiledGLSLShaderCacherSeed &seed);
+
+    /**
+     * @brief Removes the build for the seed if it didn't get taken, waiting for it to stop
+     */
+    void drop(const CompiledGLSLShaderCacherSeed &seed);
+
+    /**
+     * @brief Removes all builds that didn't get taken, such as after the methods get changed
+     */
+    void clear();
+
+    /**
+     * @returns a token to keep in the program created for the seed; no builds get started for
+     * the seed until it expires
+     */
+    std::shared_ptr<const bool> markLive(const CompiledGLSLShaderCacherSeed &seed);
+
+  protected:
+    OpenGLRenderer &m_renderer;
+
+    std::mutex m_mutex;
+    std::map<CompiledGLSLShaderCacherSeed, std::future<CompiledGLSLShader::SourceBuild>> m_builds;
+    // the cacher can't be asked what it holds, so the programs report themselves
+    std::map<CompiledGLSLShaderCacherSeed, std::weak_ptr<const bool>> m_liveSeeds;
+};
+
+/**
+ * @brief Compiles a set of programs ahead of their first use, such as behind a loading screen
+ * @note The GLSL code gets generated on the renderer's build pool as soon as a program is added;
+ * the programs themselves get created from update(), on the main thread.
+ * Keep the object alive until the first frames, so the programs stay cached.
+ */
+class CompiledGLSLShaderWarmUp
+{
+  public:
+    using ReadyCallback = std::function<void(CompiledGLSLShader &shader)>;
+
+    CompiledGLSLShaderWarmUp(ComponentRoot &root);
+    ~CompiledGLSLShaderWarmUp();
+
+    /**
+     * @brief Queues a surface program
+     * @param aliases, fragmentOutputs must outlive the warm-up
+     * @param onReady called from update() or finish() once the program is linked
+     * @param specialization as the program will be requested with when rendering
+     */
+    void addSurfaceShader(const ParamAliases &aliases, String vertexPositionOutputName,
+                          const ParamList &fragmentOutputs, ReadyCallback onReady = {},
+                          const GLProgramSpecialization &specialization = {});
+
+    /**
+     * @brief Queues a compute program
+     * @param aliases, desiredResults must outlive the warm-up
+     * @param onReady called from update() or finish() once the program is linked
+     */
+    void addComputeShader(const ParamAliases &aliases, const ParamList &desiredResults,
+                          ArgumentGetter<std::uint32_t> invocationCountX,
+                          ArgumentGetter<std::uint32_t> invocationCountY,
+                          ArgumentGetter<std::uint32_t> invocationCountZ, glm::uvec3 groupSize,
+                          bool allowOutOfBoundsCompute, ReadyCallback onReady = {});
+
+    /**
+     * @brief Keeps the aliases alive as long as the warm-up, for combinations made while queuing
+     * @returns the kept aliases
+     */
+    const ParamAliases &keepAliases(ParamAliases &&aliases);
+
+    /**
+     * @brief Creates the queued programs and checks on the ones being linked
+     * @param timeBudget how long to spend creating programs before returning; unbounded if empty
+     * @returns whether all queued programs are done
+     */
+    bool update(std::optional<std::chrono::steady_clock::duration> timeBudget = std::nullopt);
+
+    /**
+     * @brief Blocks until all queued programs are done
+     */
+    void finish();
+
+    /**
+     * @returns the number of programs that are linked or failed to compile
+     */
+    std::size_t getNumDone() const;
+    std::size_t getNumQueued() const;
+
+    /**
+     * @returns the done fraction of the queued programs, for progress bars
+     */
+    float getProgress() const;
+
+  protected:
+    struct Entry
+    {
+        CompiledGLSLShaderCacherSeed seed;
+        ReadyCallback onReady;
+
+        std::optional<dynasma::FirmPtr<CompiledGLSLShader>> p_shader;
+        bool done = false;
+    };
+
+    ComponentRoot &m_root;
+    std::vector<Entry> m_entries;
+    std::deque<ParamAliases> m_keptAliases;
+    std::size_t m_numCreated;
+    std::size_t m_numDone;
+
+    void queue(Entry &&entry);
+    void create(Entry &entry);
+    void markDone(Entry &entry);
+};
+
 } // namespace Vitrae
\ No newline at end of file
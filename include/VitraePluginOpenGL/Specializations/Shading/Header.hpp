@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Vitrae/Pipelines/Shading/Header.hpp"
+#include "VitraePluginOpenGL/Bits/TokenizedCode.hpp"
 
 #include "dynasma/keepers/abstract.hpp"
 
@@ -14,6 +15,12 @@ class OpenGLShaderHeader : public ShaderHeader
 {
     StringParams m_params;
 
+    // names of all params, in the order of their aliases passed to m_snippet
+    std::vector<String> m_paramNames;
+    GLTokenizedCode m_snippet;
+
+    void tokenizeSnippet();
+
   public:
     OpenGLShaderHeader(const FileLoadParams &params);
     OpenGLShaderHeader(const StringParams &params);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Vitrae/Pipelines/Shading/Snippet.hpp"
+#include "VitraePluginOpenGL/Bits/TokenizedCode.hpp"
 
 #include "dynasma/keepers/abstract.hpp"
 
@@ -14,7 +15,10 @@ class OpenGLShaderSnippet : public ShaderSnippet
 {
     ParamList m_inputSpecs, m_outputSpecs, m_filterSpecs, m_consumingSpecs;
     String m_friendlyName;
-    String m_snippet;
+
+    // names of all params, in the order of their aliases passed to m_snippet
+    std::vector<String> m_paramNames;
+    GLTokenizedCode m_snippet;
 
   public:
     OpenGLShaderSnippet(const StringParams &params);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Vitrae/Assets/SharedBuffer.hpp"
+#include "VitraePluginOpenGL/Bits/MemoryLedger.hpp"
 
 #include "glad/glad.h"
 
@@ -28,6 +29,9 @@ class OpenGLRawSharedBuffer : public RawSharedBuffer
 
     GLuint m_glBufferHandle;
     BufferUsageHints m_usage;
+    GLint m_maxUBOSize;
+    GLMemoryLedger &m_memoryLedger;
+    mutable std::size_t m_gpuSize;
 };
 
 } // namespace Vitrae
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Vitrae/Assets/Texture.hpp"
+#include "VitraePluginOpenGL/Bits/MemoryLedger.hpp"
 #include "glad/glad.h"
 
 #include <filesystem>
@@ -29,7 +30,7 @@ class OpenGLTexture : public Texture
     GLuint glTextureId;
 
   protected:
-    OpenGLTexture(const TextureFilteringParams& filtering);
+    OpenGLTexture(ComponentRoot &root, const TextureFilteringParams &filtering);
 
     GLint mGLInternalFormat;
     GLint mGLChannelFormat;
@@ -47,6 +48,8 @@ class OpenGLTexture : public Texture
     bool mUseSwizzle;
 
     bool m_sentToGPU;
+    GLMemoryLedger &m_memoryLedger;
+    std::size_t m_gpuMemoryCost;
 };
 
 } // namespace Vitrae
\ No newline at end of file
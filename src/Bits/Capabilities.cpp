@@ -0,0 +1,139 @@
+#include "VitraePluginOpenGL/Bits/Capabilities.hpp"
+
+#include <algorithm>
+
+// GL_NVX_gpu_memory_info isn't part of the core profile loader
+#ifndef GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX
+#define GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX 0x9047
+#endif
+
+namespace Vitrae
+{
+
+namespace
+{
+String getGLString(GLenum name)
+{
+    const GLubyte *str = glGetString(name);
+    return str ? String((const char *)str) : String();
+}
+} // namespace
+
+GLCapabilities GLCapabilities::query()
+{
+    GLCapabilities caps;
+
+    caps.vendor = getGLString(GL_VENDOR);
+    caps.renderer = getGLString(GL_RENDERER);
+    caps.version = getGLString(GL_VERSION);
+    caps.glslVersion = getGLString(GL_SHADING_LANGUAGE_VERSION);
+    glGetIntegerv(GL_MAJOR_VERSION, &caps.majorVersion);
+    glGetIntegerv(GL_MINOR_VERSION, &caps.minorVersion);
+
+    GLint numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    for (GLint i = 0; i < numExtensions; ++i) {
+        caps.extensions.emplace((const char *)glGetStringi(GL_EXTENSIONS, i));
+    }
+
+    glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &caps.maxUniformBlockSize);
+    glGetIntegerv(GL_MAX_UNIFORM_BUFFER_BINDINGS, &caps.maxUniformBufferBindings);
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &caps.uniformBufferOffsetAlignment);
+    glGetIntegerv(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &caps.maxShaderStorageBlockSize);
+    glGetIntegerv(GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS, &caps.maxShaderStorageBufferBindings);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT,
+                  &caps.shaderStorageBufferOffsetAlignment);
+
+    glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &caps.maxCombinedTextureImageUnits);
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &caps.maxTextureSize);
+    glGetIntegerv(GL_MAX_COLOR_ATTACHMENTS, &caps.maxColorAttachments);
+    glGetIntegerv(GL_MAX_DRAW_BUFFERS, &caps.maxDrawBuffers);
+    glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &caps.maxVertexAttribs);
+
+    glGetIntegerv(GL_MAX_UNIFORM_LOCATIONS, &caps.maxUniformLocations);
+    glGetIntegerv(GL_MAX_VARYING_VECTORS, &caps.maxVaryingVectors);
+
+    for (GLuint i = 0; i < 3; ++i) {
+        glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, i, &caps.maxComputeWorkGroupSize[i]);
+        glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, i, &caps.maxComputeWorkGroupCount[i]);
+    }
+    glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &caps.maxComputeWorkGroupInvocations);
+
+    GLint numProgramBinaryFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numProgramBinaryFormats);
+
+    if (caps.hasExtension("GL_NVX_gpu_memory_info")) {
+        GLint dedicatedKiB = 0;
+        glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, &dedicatedKiB);
+        caps.dedicatedVideoMemory = (std::size_t)dedicatedKiB * 1024;
+    }
+
+    caps.hasParallelShaderCompile = caps.hasExtension("GL_KHR_parallel_shader_compile") ||
+                                    caps.hasExtension("GL_ARB_parallel_shader_compile");
+    caps.hasBufferStorage =
+        caps.isVersionAtLeast(4, 4) || caps.hasExtension("GL_ARB_buffer_storage");
+    caps.hasMultiDrawIndirect =
+        caps.isVersionAtLeast(4, 3) || caps.hasExtension("GL_ARB_multi_draw_indirect");
+    caps.hasDirectStateAccess =
+        caps.isVersionAtLeast(4, 5) || caps.hasExtension("GL_ARB_direct_state_access");
+    caps.hasSpirV = caps.isVersionAtLeast(4, 6) || caps.hasExtension("GL_ARB_gl_spirv");
+    caps.hasSeparateShaderObjects =
+        caps.isVersionAtLeast(4, 1) || caps.hasExtension("GL_ARB_separate_shader_objects");
+    caps.hasProgramBinary = numProgramBinaryFormats > 0;
+    caps.hasPipelineStatisticsQuery =
+        caps.isVersionAtLeast(4, 6) || caps.hasExtension("GL_ARB_pipeline_statistics_query");
+
+    return caps;
+}
+
+bool GLCapabilities::hasExtension(const String &name) const
+{
+    return extensions.find(name) != extensions.end();
+}
+
+bool GLCapabilities::isVersionAtLeast(GLint major, GLint minor) const
+{
+    return majorVersion > major || (majorVersion == major && minorVersion >= minor);
+}
+
+glm::ivec3 GLCapabilities::getAutoComputeGroupSize() const
+{
+    // 64 is a multiple of both the common warp (32) and wavefront (64) widths
+    return {std::min({64, maxComputeWorkGroupSize.x, maxComputeWorkGroupInvocations}), 1, 1};
+}
+
+void GLCapabilities::print(std::ostream &out) const
+{
+    out << "OpenGL " << version << " (GLSL " << glslVersion << ") on " << renderer << " by "
+        << vendor << std::endl;
+
+    out << "OpenGL extensions:" << std::endl;
+    for (const String &ext : extensions) {
+        out << "\t" << ext << std::endl;
+    }
+    out << "OpenGL end of extensions" << std::endl;
+
+    out << "OpenGL limits:" << std::endl;
+    out << "\tmax UBO size: " << maxUniformBlockSize << std::endl;
+    out << "\tmax SSBO bindings: " << maxShaderStorageBufferBindings << std::endl;
+    out << "\tmax texture units: " << maxCombinedTextureImageUnits << std::endl;
+    out << "\tmax compute group size: " << maxComputeWorkGroupSize.x << "x"
+        << maxComputeWorkGroupSize.y << "x" << maxComputeWorkGroupSize.z << " ("
+        << maxComputeWorkGroupInvocations << " invocations)" << std::endl;
+    if (dedicatedVideoMemory != 0) {
+        out << "\tdedicated video memory: " << dedicatedVideoMemory / (1024 * 1024) << " MiB"
+            << std::endl;
+    }
+
+    out << "OpenGL features:" << std::endl;
+    out << "\tparallel shader compile: " << hasParallelShaderCompile << std::endl;
+    out << "\tbuffer storage: " << hasBufferStorage << std::endl;
+    out << "\tmulti draw indirect: " << hasMultiDrawIndirect << std::endl;
+    out << "\tdirect state access: " << hasDirectStateAccess << std::endl;
+    out << "\tSPIR-V: " << hasSpirV << std::endl;
+    out << "\tseparate shader objects: " << hasSeparateShaderObjects << std::endl;
+    out << "\tprogram binary: " << hasProgramBinary << std::endl;
+    out << "\tpipeline statistics: " << hasPipelineStatisticsQuery << std::endl;
+}
+
+} // namespace Vitrae
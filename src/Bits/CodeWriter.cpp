@@ -0,0 +1,118 @@
+#include "VitraePluginOpenGL/Bits/CodeWriter.hpp"
+
+#include <algorithm>
+
+namespace Vitrae
+{
+
+/*
+Buffer
+*/
+
+void GLCodeBuffer::clear()
+{
+    m_code.clear();
+}
+
+StringView GLCodeBuffer::getCode() const
+{
+    return m_code;
+}
+
+GLCodeBuffer::int_type GLCodeBuffer::overflow(int_type ch)
+{
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        m_code.push_back(traits_type::to_char_type(ch));
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize GLCodeBuffer::xsputn(const char *s, std::streamsize count)
+{
+    m_code.append(s, count);
+    return count;
+}
+
+/*
+Identifier arena
+*/
+
+StringView GLIdentifierArena::intern(StringView prefix, StringView name)
+{
+    std::size_t size = prefix.size() + name.size();
+    char *p_dest = allocate(size);
+    std::copy(prefix.begin(), prefix.end(), p_dest);
+    std::copy(name.begin(), name.end(), p_dest + prefix.size());
+
+    auto [it, inserted] = m_identifiers.insert(StringView(p_dest, size));
+    if (!inserted) {
+        // already interned, so give the space back
+        m_chunkOffset -= size;
+    }
+    return *it;
+}
+
+void GLIdentifierArena::reset()
+{
+    m_identifiers.clear();
+    m_chunkIndex = 0;
+    m_chunkOffset = 0;
+}
+
+char *GLIdentifierArena::allocate(std::size_t size)
+{
+    while (m_chunkIndex < m_chunks.size() && m_chunkOffset + size > m_chunks[m_chunkIndex].size) {
+        ++m_chunkIndex;
+        m_chunkOffset = 0;
+    }
+    if (m_chunkIndex == m_chunks.size()) {
+        std::size_t chunkSize = std::max(CHUNK_SIZE, size);
+        m_chunks.push_back(Chunk{
+            .p_data = std::make_unique<char[]>(chunkSize),
+            .size = chunkSize,
+        });
+    }
+
+    char *p_dest = m_chunks[m_chunkIndex].p_data.get() + m_chunkOffset;
+    m_chunkOffset += size;
+    return p_dest;
+}
+
+/*
+Writer
+*/
+
+GLCodeWriter::GLCodeWriter()
+{
+    // the stream keeps its own string buffer, but writes go into ours instead
+    m_stream.std::ios::rdbuf(&m_buffer);
+}
+
+std::stringstream &GLCodeWriter::stream()
+{
+    return m_stream;
+}
+
+StringView GLCodeWriter::getCode() const
+{
+    return m_buffer.getCode();
+}
+
+void GLCodeWriter::clearCode()
+{
+    m_buffer.clear();
+    m_stream.clear();
+}
+
+StringView GLCodeWriter::intern(StringView prefix, StringView name)
+{
+    return m_identifiers.intern(prefix, name);
+}
+
+void GLCodeWriter::reset()
+{
+    clearCode();
+    m_identifiers.reset();
+}
+
+} // namespace Vitrae
@@ -0,0 +1,174 @@
+#include "VitraePluginOpenGL/Bits/CommandBuffer.hpp"
+#include "Vitrae/Data/Overloaded.hpp"
+#include "VitraePluginOpenGL/Specializations/Renderer.hpp"
+
+#include "MMeter.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Vitrae
+{
+
+/*
+Command buffer
+*/
+
+GLCommandBuffer::GLCommandBuffer(std::uint32_t orderKey) : m_orderKey(orderKey) {}
+
+void GLCommandBuffer::bufferSubData(GLuint buffer, std::size_t offset, const void *data,
+                                    std::size_t size)
+{
+    m_commands.emplace_back(BufferSubDataCmd{
+        .buffer = buffer,
+        .offset = offset,
+        .dataOffset = storeData(data, size),
+        .dataSize = size,
+    });
+}
+
+void GLCommandBuffer::textureSubImage2D(GLuint texture, GLint level, glm::ivec2 offset,
+                                        glm::ivec2 size, GLenum format, GLenum type,
+                                        const void *data, std::size_t dataSize)
+{
+    m_commands.emplace_back(TextureSubImage2DCmd{
+        .texture = texture,
+        .level = level,
+        .offset = offset,
+        .size = size,
+        .format = format,
+        .type = type,
+        .dataOffset = storeData(data, dataSize),
+    });
+}
+
+void GLCommandBuffer::setUniform(GLuint program, GLint location, const GLConversionSpec &convSpec,
+                                 const Variant &hostValue)
+{
+    if (!convSpec.setUniform) {
+        throw std::invalid_argument("Recorded uniform type has no uniform conversion");
+    }
+
+    m_commands.emplace_back(SetUniformCmd{
+        .program = program,
+        .location = location,
+        .p_convSpec = &convSpec,
+        .hostValue = hostValue,
+    });
+}
+
+void GLCommandBuffer::call(std::function<void()> command)
+{
+    m_commands.emplace_back(std::move(command));
+}
+
+void GLCommandBuffer::replay() const
+{
+    for (const Command &command : m_commands) {
+        std::visit(Overloaded{
+                       [&](const BufferSubDataCmd &cmd) {
+                           glNamedBufferSubData(cmd.buffer, cmd.offset, cmd.dataSize,
+                                                m_data.data() + cmd.dataOffset);
+                       },
+                       [&](const TextureSubImage2DCmd &cmd) {
+                           glTextureSubImage2D(cmd.texture, cmd.level, cmd.offset.x, cmd.offset.y,
+                                               cmd.size.x, cmd.size.y, cmd.format, cmd.type,
+                                               m_data.data() + cmd.dataOffset);
+                       },
+                       [&](const SetUniformCmd &cmd) {
+                           GLStateCache::current().useProgram(cmd.program);
+                           cmd.p_convSpec->setUniform(cmd.location, cmd.hostValue);
+                       },
+                       [&](const std::function<void()> &cmd) { cmd(); },
+                   },
+                   command);
+    }
+}
+
+void GLCommandBuffer::clear()
+{
+    m_commands.clear();
+    m_data.clear();
+}
+
+bool GLCommandBuffer::empty() const
+{
+    return m_commands.empty();
+}
+
+std::size_t GLCommandBuffer::size() const
+{
+    return m_commands.size();
+}
+
+std::size_t GLCommandBuffer::storeData(const void *data, std::size_t size)
+{
+    std::size_t dataOffset = m_data.size();
+    m_data.resize(dataOffset + size);
+    if (size > 0) {
+        std::memcpy(m_data.data() + dataOffset, data, size);
+    }
+    return dataOffset;
+}
+
+/*
+Command queue
+*/
+
+GLCommandQueue::~GLCommandQueue()
+{
+    Node *p_node = m_head.exchange(nullptr, std::memory_order_acquire);
+    while (p_node) {
+        std::unique_ptr<Node> p_owned(p_node);
+        p_node = p_owned->p_next;
+    }
+}
+
+void GLCommandQueue::submit(GLCommandBuffer &&buffer)
+{
+    auto p_node = std::make_unique<Node>(Node{
+        .buffer = std::move(buffer),
+        .sequence = m_nextSequence.fetch_add(1, std::memory_order_relaxed),
+        .p_next = m_head.load(std::memory_order_relaxed),
+    });
+
+    while (!m_head.compare_exchange_weak(p_node->p_next, p_node.get(), std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+    }
+
+    // the list owns it now
+    p_node.release();
+}
+
+void GLCommandQueue::replayAll()
+{
+    MMETER_SCOPE_PROFILER("GLCommandQueue::replayAll");
+
+    Node *p_node = m_head.exchange(nullptr, std::memory_order_acquire);
+    if (!p_node) {
+        return;
+    }
+
+    // take ownership first, so the nodes get freed even if a replay throws
+    m_replayOrder.clear();
+    while (p_node) {
+        Node *p_next = p_node->p_next;
+        m_replayOrder.emplace_back(p_node);
+        p_node = p_next;
+    }
+
+    std::sort(m_replayOrder.begin(), m_replayOrder.end(),
+              [](const std::unique_ptr<Node> &l, const std::unique_ptr<Node> &r) {
+                  if (l->buffer.getOrderKey() != r->buffer.getOrderKey()) {
+                      return l->buffer.getOrderKey() < r->buffer.getOrderKey();
+                  }
+                  return l->sequence < r->sequence;
+              });
+
+    for (const std::unique_ptr<Node> &p_orderedNode : m_replayOrder) {
+        p_orderedNode->buffer.replay();
+    }
+    m_replayOrder.clear();
+}
+
+} // namespace Vitrae
@@ -0,0 +1,109 @@
+#include "VitraePluginOpenGL/Bits/DebugAggregator.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Vitrae
+{
+
+const char *getGLDebugTypeDescription(GLenum type)
+{
+    switch (type) {
+    case GL_DEBUG_TYPE_ERROR:
+        return "OpenGL error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+        return "OpenGL deprecated behavior";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+        return "OpenGL undefined behavior";
+    case GL_DEBUG_TYPE_PORTABILITY:
+        return "OpenGL portability issue";
+    case GL_DEBUG_TYPE_PERFORMANCE:
+        return "OpenGL performance issue";
+    default:
+        return nullptr;
+    }
+}
+
+GLDebugAggregator::GLDebugAggregator(std::ostream &out, std::chrono::milliseconds flushInterval)
+    : m_out(out), m_flushInterval(flushInterval)
+{
+    m_flushThread = std::thread([this]() {
+        std::unique_lock lock(m_flushMutex);
+        while (!m_stopping) {
+            m_stopCondition.wait_for(lock, m_flushInterval);
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+    });
+}
+
+GLDebugAggregator::~GLDebugAggregator()
+{
+    {
+        std::unique_lock lock(m_flushMutex);
+        m_stopping = true;
+    }
+    m_stopCondition.notify_all();
+    m_flushThread.join();
+
+    flush();
+}
+
+void GLDebugAggregator::record(GLenum type, GLuint id, const GLchar *message, GLsizei length)
+{
+    const std::uint64_t key = ((std::uint64_t)type << 32 | id) + 1;
+
+    // open addressing; a slot is never released, so the probe sequence stays valid
+    std::size_t index = (std::size_t)(key * 0x9E3779B97F4A7C15ull >> 56) % NUM_SLOTS;
+    for (std::size_t probe = 0; probe < NUM_SLOTS; ++probe) {
+        Slot &slot = m_slots[(index + probe) % NUM_SLOTS];
+
+        std::uint64_t slotKey = slot.key.load(std::memory_order_acquire);
+        if (slotKey == 0) {
+            std::uint64_t expected = 0;
+            if (slot.key.compare_exchange_strong(expected, key, std::memory_order_acq_rel)) {
+                // we own the slot; publish the message
+                std::size_t messageLength =
+                    length < 0 ? std::strlen(message) : (std::size_t)length;
+                messageLength = std::min(messageLength, MAX_MESSAGE_LENGTH - 1);
+                std::memcpy(slot.message, message, messageLength);
+                slot.message[messageLength] = '\0';
+                slot.type = type;
+                slot.ready.store(true, std::memory_order_release);
+
+                slot.count.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            slotKey = expected;
+        }
+        if (slotKey == key) {
+            slot.count.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    m_numDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void GLDebugAggregator::flush()
+{
+    for (Slot &slot : m_slots) {
+        if (!slot.ready.load(std::memory_order_acquire)) {
+            continue;
+        }
+
+        std::uint64_t count = slot.count.exchange(0, std::memory_order_relaxed);
+        if (count > 0) {
+            m_out << getGLDebugTypeDescription(slot.type) << " (id "
+                  << ((slot.key.load(std::memory_order_relaxed) - 1) & 0xFFFFFFFFull) << ", "
+                  << count << "x): " << slot.message << std::endl;
+        }
+    }
+
+    if (std::uint64_t numDropped = m_numDropped.exchange(0, std::memory_order_relaxed)) {
+        m_out << "OpenGL debug messages dropped: " << numDropped << std::endl;
+    }
+}
+
+} // namespace Vitrae
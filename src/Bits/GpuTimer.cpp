@@ -0,0 +1,143 @@
+#include "VitraePluginOpenGL/Bits/GpuTimer.hpp"
+
+namespace Vitrae
+{
+
+GLGpuTimer::Scope::Scope(GLGpuTimer &timer, StringView name)
+    : m_timer(timer), m_index(timer.beginScope(name)), m_frameSerial(timer.m_frameSerial)
+{}
+
+GLGpuTimer::Scope::~Scope()
+{
+    m_timer.endScope(m_index, m_frameSerial);
+}
+
+GLGpuTimer::GLGpuTimer(std::size_t numFramesInFlight, std::size_t maxScopesPerFrame)
+    : m_maxScopesPerFrame(maxScopesPerFrame), m_frames(numFramesInFlight), m_currentFrameIndex(0),
+      m_frameSerial(0), m_enabled(false), m_numDroppedFrames(0)
+{}
+
+GLGpuTimer::~GLGpuTimer() {}
+
+void GLGpuTimer::setup()
+{
+    m_ownerThreadId = std::this_thread::get_id();
+
+    for (Frame &frame : m_frames) {
+        frame.queries.resize(2 * m_maxScopesPerFrame);
+        glCreateQueries(GL_TIMESTAMP, frame.queries.size(), frame.queries.data());
+        frame.scopes.reserve(m_maxScopesPerFrame);
+    }
+
+    m_enabled = true;
+}
+
+void GLGpuTimer::free()
+{
+    if (m_enabled) {
+        for (Frame &frame : m_frames) {
+            glDeleteQueries(frame.queries.size(), frame.queries.data());
+            frame.queries.clear();
+            frame.scopes.clear();
+        }
+        m_enabled = false;
+    }
+}
+
+bool GLGpuTimer::isEnabled() const
+{
+    return m_enabled;
+}
+
+void GLGpuTimer::nextFrame()
+{
+    if (!m_enabled) {
+        return;
+    }
+
+    // scopes spanning the frame boundary get cut short, so every used query gets a result
+    for (std::size_t index : m_openScopes) {
+        glQueryCounter(m_frames[m_currentFrameIndex].queries[2 * index + 1], GL_TIMESTAMP);
+    }
+    m_openScopes.clear();
+
+    m_currentFrameIndex = (m_currentFrameIndex + 1) % m_frames.size();
+    ++m_frameSerial;
+
+    // the frame we're about to reuse is the oldest one in flight
+    Frame &frame = m_frames[m_currentFrameIndex];
+    if (!frame.scopes.empty()) {
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(frame.queries[2 * frame.scopes.size() - 1], GL_QUERY_RESULT_AVAILABLE,
+                           &available);
+
+        if (available) {
+            m_lastResults.clear();
+            for (std::size_t i = 0; i < frame.scopes.size(); ++i) {
+                GLuint64 beginTime = 0, endTime = 0;
+                glGetQueryObjectui64v(frame.queries[2 * i], GL_QUERY_RESULT, &beginTime);
+                glGetQueryObjectui64v(frame.queries[2 * i + 1], GL_QUERY_RESULT, &endTime);
+
+                m_lastResults.push_back(ScopeTiming{
+                    .name = frame.scopes[i].name,
+                    .depth = frame.scopes[i].depth,
+                    .milliseconds = (double)(endTime - beginTime) / 1'000'000.0,
+                });
+            }
+        } else {
+            ++m_numDroppedFrames;
+        }
+    }
+    frame.scopes.clear();
+}
+
+const std::vector<GLGpuTimer::ScopeTiming> &GLGpuTimer::getLastResults() const
+{
+    return m_lastResults;
+}
+
+std::size_t GLGpuTimer::getNumDroppedFrames() const
+{
+    return m_numDroppedFrames;
+}
+
+void GLGpuTimer::printLastResults(std::ostream &out) const
+{
+    out << "GPU timings:" << std::endl;
+    for (const ScopeTiming &timing : m_lastResults) {
+        out << String(timing.depth + 1, '\t') << timing.name << ": " << timing.milliseconds
+            << " ms" << std::endl;
+    }
+}
+
+std::size_t GLGpuTimer::beginScope(StringView name)
+{
+    if (!m_enabled || std::this_thread::get_id() != m_ownerThreadId) {
+        return NO_SCOPE;
+    }
+
+    Frame &frame = m_frames[m_currentFrameIndex];
+    if (frame.scopes.size() >= m_maxScopesPerFrame) {
+        return NO_SCOPE;
+    }
+
+    std::size_t index = frame.scopes.size();
+    frame.scopes.push_back(ScopeRecord{.name = String(name), .depth = m_openScopes.size()});
+    glQueryCounter(frame.queries[2 * index], GL_TIMESTAMP);
+    m_openScopes.push_back(index);
+
+    return index;
+}
+
+void GLGpuTimer::endScope(std::size_t index, std::size_t frameSerial)
+{
+    // scopes from previous frames were already ended by nextFrame()
+    if (index == NO_SCOPE || frameSerial != m_frameSerial) {
+        return;
+    }
+
+    glQueryCounter(m_frames[m_currentFrameIndex].queries[2 * index + 1], GL_TIMESTAMP);
+    std::erase(m_openScopes, index);
+}
+
+} // namespace Vitrae
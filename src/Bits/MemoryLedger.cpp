@@ -0,0 +1,105 @@
+#include "VitraePluginOpenGL/Bits/MemoryLedger.hpp"
+
+namespace Vitrae
+{
+
+namespace
+{
+const char *getCategoryName(GLMemoryCategory category)
+{
+    switch (category) {
+    case GLMemoryCategory::Textures:
+        return "textures";
+    case GLMemoryCategory::Buffers:
+        return "buffers";
+    case GLMemoryCategory::Framebuffers:
+        return "framebuffers";
+    case GLMemoryCategory::Programs:
+        return "programs";
+    default:
+        return "unknown";
+    }
+}
+} // namespace
+
+GLMemoryLedger::GLMemoryLedger() : m_totalUsage(0), m_budget(0)
+{
+    for (auto &usage : m_usage) {
+        usage = 0;
+    }
+}
+
+void GLMemoryLedger::setBudget(std::size_t budget)
+{
+    m_budget = budget;
+}
+
+std::size_t GLMemoryLedger::getBudget() const
+{
+    return m_budget;
+}
+
+void GLMemoryLedger::add(GLMemoryCategory category, std::size_t bytes)
+{
+    m_usage[(std::size_t)category].fetch_add(bytes, std::memory_order_relaxed);
+    m_totalUsage.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void GLMemoryLedger::remove(GLMemoryCategory category, std::size_t bytes)
+{
+    m_usage[(std::size_t)category].fetch_sub(bytes, std::memory_order_relaxed);
+    m_totalUsage.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+std::size_t GLMemoryLedger::getUsage(GLMemoryCategory category) const
+{
+    return m_usage[(std::size_t)category].load(std::memory_order_relaxed);
+}
+
+std::size_t GLMemoryLedger::getTotalUsage() const
+{
+    return m_totalUsage.load(std::memory_order_relaxed);
+}
+
+bool GLMemoryLedger::isOverBudget() const
+{
+    return m_budget != 0 && getTotalUsage() > m_budget;
+}
+
+void GLMemoryLedger::addEvictor(Evictor evictor)
+{
+    std::unique_lock lock(m_evictorsMutex);
+    m_evictors.push_back(std::move(evictor));
+}
+
+void GLMemoryLedger::enforceBudget()
+{
+    if (!isOverBudget()) {
+        return;
+    }
+
+    std::unique_lock lock(m_evictorsMutex);
+    for (auto &evictor : m_evictors) {
+        std::size_t total = getTotalUsage();
+        if (total <= m_budget) {
+            break;
+        }
+        evictor(total - m_budget);
+    }
+}
+
+void GLMemoryLedger::print(std::ostream &out) const
+{
+    out << "Video memory: " << getTotalUsage() / 1024 << " KiB";
+    if (m_budget != 0) {
+        out << " of " << m_budget / 1024 << " KiB budget";
+    }
+    out << std::endl;
+
+    for (std::size_t i = 0; i < (std::size_t)GLMemoryCategory::COUNT; ++i) {
+        out << "\t" << getCategoryName((GLMemoryCategory)i) << ": "
+            << m_usage[i].load(std::memory_order_relaxed) / 1024 << " KiB" << std::endl;
+    }
+}
+
+} // namespace Vitrae
@@ -0,0 +1,262 @@
+#include "VitraePluginOpenGL/Bits/ProgramBinaryCache.hpp"
+#include "VitraePluginOpenGL/Bits/Capabilities.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+namespace Vitrae
+{
+
+namespace
+{
+constexpr char ENTRY_MAGIC[4] = {'V', 'G', 'P', 'B'};
+constexpr std::uint32_t ENTRY_VERSION = 4;
+
+// sanity limits, so a corrupt length doesn't allocate gigabytes
+constexpr std::uint64_t MAX_BINARY_SIZE = 1 << 28;
+constexpr std::uint64_t MAX_STRING_SIZE = 1 << 16;
+constexpr std::uint64_t MAX_NUM_INDICES = 1 << 16;
+
+std::uint64_t fnv1a(std::uint64_t hash, StringView data)
+{
+    for (char c : data) {
+        hash ^= (unsigned char)c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// independent of fnv1a, so a collision of the names doesn't imply one of the check hashes
+std::uint64_t polynomialHash(std::uint64_t hash, StringView data)
+{
+    for (char c : data) {
+        hash = (hash + (unsigned char)c + 1) * 0x9e3779b97f4a7c15ull;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+template <class T> void writePod(std::ostream &out, const T &value)
+{
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <class T> bool readPod(std::istream &in, T &value)
+{
+    return (bool)in.read(reinterpret_cast<char *>(&value), sizeof(T));
+}
+
+void writeString(std::ostream &out, StringView str)
+{
+    writePod<std::uint64_t>(out, str.size());
+    out.write(str.data(), str.size());
+}
+
+bool readString(std::istream &in, String &str)
+{
+    std::uint64_t size;
+    if (!readPod(in, size) || size > MAX_STRING_SIZE) {
+        return false;
+    }
+    str.resize(size);
+    return (bool)in.read(str.data(), size);
+}
+
+void writeIndices(std::ostream &out, const std::vector<GLint> &indices)
+{
+    writePod<std::uint64_t>(out, indices.size());
+    out.write(reinterpret_cast<const char *>(indices.data()), indices.size() * sizeof(GLint));
+}
+
+bool readIndices(std::istream &in, std::vector<GLint> &indices)
+{
+    std::uint64_t size;
+    if (!readPod(in, size) || size > MAX_NUM_INDICES) {
+        return false;
+    }
+    indices.resize(size);
+    return (bool)in.read(reinterpret_cast<char *>(indices.data()), size * sizeof(GLint));
+}
+} // namespace
+
+GLActiveProgramInterface GLActiveProgramInterface::query(GLuint program)
+{
+    GLActiveProgramInterface activeInterface;
+
+    GLint numUniforms = 0;
+    glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &numUniforms);
+    for (GLint i = 0; i < numUniforms; ++i) {
+        const GLenum props[] = {GL_BLOCK_INDEX, GL_LOCATION};
+        GLint values[2];
+        glGetProgramResourceiv(program, GL_UNIFORM, i, 2, props, 2, nullptr, values);
+
+        // block members are set through their blocks
+        if (values[0] == -1 && values[1] != -1) {
+            activeInterface.uniformLocations.push_back(values[1]);
+        }
+    }
+
+    for (auto [programInterface, p_bindings] : {
+             std::pair{GL_UNIFORM_BLOCK, &activeInterface.uniformBlockBindings},
+             std::pair{GL_SHADER_STORAGE_BLOCK, &activeInterface.storageBlockBindings},
+         }) {
+        GLint numBlocks = 0;
+        glGetProgramInterfaceiv(program, programInterface, GL_ACTIVE_RESOURCES, &numBlocks);
+        for (GLint i = 0; i < numBlocks; ++i) {
+            const GLenum prop = GL_BUFFER_BINDING;
+            GLint binding;
+            glGetProgramResourceiv(program, programInterface, i, 1, &prop, 1, nullptr, &binding);
+            p_bindings->push_back(binding);
+        }
+    }
+
+    return activeInterface;
+}
+
+GLProgramBinaryCache::GLProgramBinaryCache() : m_enabled(false) {}
+
+void GLProgramBinaryCache::setup(const std::filesystem::path &directory,
+                                 const GLCapabilities &caps)
+{
+    m_enabled = false;
+
+    if (directory.empty() || !caps.hasProgramBinary) {
+        return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) {
+        return;
+    }
+
+    m_directory = directory;
+    m_driverId = caps.vendor + "\n" + caps.renderer + "\n" + caps.version;
+    m_enabled = true;
+}
+
+bool GLProgramBinaryCache::isEnabled() const
+{
+    return m_enabled;
+}
+
+GLProgramBinaryCache::Key GLProgramBinaryCache::computeKey(
+    std::span<const String> stageSources) const
+{
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    hash = fnv1a(hash, m_driverId);
+
+    Key key{.sourceHash = 0, .sourceLength = 0};
+    for (const String &source : stageSources) {
+        // separate the stages, so moving code between them changes the key
+        hash = fnv1a(hash, StringView("\0", 1));
+        hash = fnv1a(hash, source);
+
+        key.sourceHash = polynomialHash(key.sourceHash, StringView("\0", 1));
+        key.sourceHash = polynomialHash(key.sourceHash, source);
+        key.sourceLength += source.size() + 1;
+    }
+
+    std::stringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+    key.name = ss.str();
+    return key;
+}
+
+std::optional<GLProgramBinaryCache::Entry> GLProgramBinaryCache::load(const Key &key) const
+{
+    if (!m_enabled) {
+        return std::nullopt;
+    }
+
+    std::ifstream file(m_directory / (key.name + ".bin"), std::ios::binary);
+    if (!file) {
+        return std::nullopt;
+    }
+
+    char magic[4];
+    std::uint32_t version;
+    String driverId;
+    if (!file.read(magic, sizeof(magic)) ||
+        !std::equal(std::begin(magic), std::end(magic), std::begin(ENTRY_MAGIC)) ||
+        !readPod(file, version) || version != ENTRY_VERSION || !readString(file, driverId) ||
+        driverId != m_driverId) {
+        return std::nullopt;
+    }
+
+    std::uint64_t sourceHash, sourceLength;
+    if (!readPod(file, sourceHash) || !readPod(file, sourceLength) ||
+        sourceHash != key.sourceHash || sourceLength != key.sourceLength) {
+        return std::nullopt;
+    }
+
+    Entry entry;
+    std::uint64_t binarySize;
+    if (!readPod(file, entry.binaryFormat) || !readPod(file, binarySize) ||
+        binarySize > MAX_BINARY_SIZE) {
+        return std::nullopt;
+    }
+    entry.binary.resize(binarySize);
+    if (!file.read(entry.binary.data(), binarySize)) {
+        return std::nullopt;
+    }
+
+    if (!readIndices(file, entry.activeInterface.uniformLocations) ||
+        !readIndices(file, entry.activeInterface.uniformBlockBindings) ||
+        !readIndices(file, entry.activeInterface.storageBlockBindings)) {
+        return std::nullopt;
+    }
+
+    return entry;
+}
+
+void GLProgramBinaryCache::store(const Key &key, const Entry &entry) const
+{
+    if (!m_enabled) {
+        return;
+    }
+
+    // write to a temporary file first, so readers never see a partial entry
+    std::stringstream tmpName;
+    tmpName << key.name << "." << std::this_thread::get_id() << ".tmp";
+    std::filesystem::path tmpPath = m_directory / tmpName.str();
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return;
+        }
+
+        file.write(ENTRY_MAGIC, sizeof(ENTRY_MAGIC));
+        writePod(file, ENTRY_VERSION);
+        writeString(file, m_driverId);
+        writePod(file, key.sourceHash);
+        writePod(file, key.sourceLength);
+
+        writePod(file, entry.binaryFormat);
+        writePod<std::uint64_t>(file, entry.binary.size());
+        file.write(entry.binary.data(), entry.binary.size());
+
+        writeIndices(file, entry.activeInterface.uniformLocations);
+        writeIndices(file, entry.activeInterface.uniformBlockBindings);
+        writeIndices(file, entry.activeInterface.storageBlockBindings);
+
+        if (!file) {
+            file.close();
+            std::error_code ec;
+            std::filesystem::remove(tmpPath, ec);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, m_directory / (key.name + ".bin"), ec);
+    if (ec) {
+        std::filesystem::remove(tmpPath, ec);
+    }
+}
+
+} // namespace Vitrae
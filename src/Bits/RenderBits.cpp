@@ -1,4 +1,5 @@
 #include "VitraePluginOpenGL/Bits/RenderBits.hpp"
+#include "VitraePluginOpenGL/Bits/StateCache.hpp"
 
 #include "Vitrae/Data/Blending.hpp"
 #include "Vitrae/Data/FragmentTest.hpp"
@@ -93,57 +94,59 @@ void stateSetupRasterizing(const RasterizingSetupParams &params)
 {
     MMETER_FUNC_PROFILER;
 
+    GLStateCache &state = GLStateCache::current();
+
     {
         MMETER_SCOPE_PROFILER("General setup");
 
         if (params.depthTest == FragmentTestFunction::Always) {
-            glDisable(GL_DEPTH_TEST);
+            state.setCapability(GL_DEPTH_TEST, false);
         } else {
-            glEnable(GL_DEPTH_TEST);
-            glDepthFunc(convertTestFunction(params.depthTest));
+            state.setCapability(GL_DEPTH_TEST, true);
+            state.depthFunc(convertTestFunction(params.depthTest));
         }
 
         switch (params.cullingMode) {
         case CullingMode::None:
-            glDisable(GL_CULL_FACE);
+            state.setCapability(GL_CULL_FACE, false);
             break;
         case CullingMode::Backface:
-            glEnable(GL_CULL_FACE);
-            glCullFace(GL_BACK);
+            state.setCapability(GL_CULL_FACE, true);
+            state.cullFace(GL_BACK);
             break;
         case CullingMode::Frontface:
-            glEnable(GL_CULL_FACE);
-            glCullFace(GL_FRONT);
+            state.setCapability(GL_CULL_FACE, true);
+            state.cullFace(GL_FRONT);
             break;
         }
 
         // smoothing
         if (params.smoothFilling) {
-            glEnable(GL_POLYGON_SMOOTH);
-            glHint(GL_POLYGON_SMOOTH_HINT, GL_NICEST);
+            state.setCapability(GL_POLYGON_SMOOTH, true);
+            state.hint(GL_POLYGON_SMOOTH_HINT, GL_NICEST);
         } else {
-            glDisable(GL_POLYGON_SMOOTH);
+            state.setCapability(GL_POLYGON_SMOOTH, false);
         }
         if (params.smoothTracing) {
-            glEnable(GL_LINE_SMOOTH);
-            glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
-            glLineWidth(params.lineWidth + 0.5);
+            state.setCapability(GL_LINE_SMOOTH, true);
+            state.hint(GL_LINE_SMOOTH_HINT, GL_NICEST);
+            state.lineWidth(params.lineWidth + 0.5);
         } else {
-            glDisable(GL_LINE_SMOOTH);
-            glLineWidth(params.lineWidth);
+            state.setCapability(GL_LINE_SMOOTH, false);
+            state.lineWidth(params.lineWidth);
         }
 
-        glDepthMask(params.writeDepth);
+        state.depthMask(params.writeDepth);
         if (params.blending == BlendingCommon::None) {
-            glDisable(GL_BLEND);
+            state.setCapability(GL_BLEND, false);
         } else {
-            glEnable(GL_BLEND);
-            glBlendEquationSeparate(convertBlendingOperation(params.blending.operationRGB),
-                                    convertBlendingOperation(params.blending.operationAlpha));
-            glBlendFuncSeparate(convertBlendingFactor(params.blending.sourceRGB),
-                                convertBlendingFactor(params.blending.destinationRGB),
-                                convertBlendingFactor(params.blending.sourceAlpha),
-                                convertBlendingFactor(params.blending.destinationAlpha));
+            state.setCapability(GL_BLEND, true);
+            state.blendEquationSeparate(convertBlendingOperation(params.blending.operationRGB),
+                                        convertBlendingOperation(params.blending.operationAlpha));
+            state.blendFuncSeparate(convertBlendingFactor(params.blending.sourceRGB),
+                                    convertBlendingFactor(params.blending.destinationRGB),
+                                    convertBlendingFactor(params.blending.sourceAlpha),
+                                    convertBlendingFactor(params.blending.destinationAlpha));
         }
     }
 
@@ -153,13 +156,13 @@ void stateSetupRasterizing(const RasterizingSetupParams &params)
 
         switch (params.rasterizingMode) {
         case RasterizingMode::DerivationalFillCenters:
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            state.polygonMode(GL_FILL);
             break;
         case RasterizingMode::DerivationalTraceEdges:
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            state.polygonMode(GL_LINE);
             break;
         case RasterizingMode::DerivationalDotVertices:
-            glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
+            state.polygonMode(GL_POINT);
             break;
         default:
             break;
@@ -169,6 +172,8 @@ void stateSetupRasterizing(const RasterizingSetupParams &params)
 
 void rasterizeShape(const Shape &shape, const RasterizingSetupParams &params)
 {
+    GLStateCache &state = GLStateCache::current();
+
     switch (params.rasterizingMode) {
     case RasterizingMode::DerivationalFillCenters:
     case RasterizingMode::DerivationalTraceEdges:
@@ -177,23 +182,23 @@ void rasterizeShape(const Shape &shape, const RasterizingSetupParams &params)
         shape.rasterize();
         break;
     case RasterizingMode::DerivationalFillEdges:
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        state.polygonMode(GL_FILL);
         shape.rasterize();
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        state.polygonMode(GL_LINE);
         shape.rasterize();
         break;
     case RasterizingMode::DerivationalFillVertices:
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        state.polygonMode(GL_FILL);
         shape.rasterize();
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        state.polygonMode(GL_LINE);
         shape.rasterize();
-        glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
+        state.polygonMode(GL_POINT);
         shape.rasterize();
         break;
     case RasterizingMode::DerivationalTraceVertices:
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        state.polygonMode(GL_LINE);
         shape.rasterize();
-        glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
+        state.polygonMode(GL_POINT);
         shape.rasterize();
         break;
     }
@@ -0,0 +1,214 @@
+#include "VitraePluginOpenGL/Bits/RenderStats.hpp"
+
+namespace Vitrae
+{
+
+namespace
+{
+thread_local GLTaskCounters tp_scratchCounters;
+thread_local GLTaskCounters *tp_currentCounters = nullptr;
+} // namespace
+
+GLTaskCounters &GLTaskCounters::operator+=(const GLTaskCounters &o)
+{
+    draws += o.draws;
+    triangles += o.triangles;
+    dispatches += o.dispatches;
+    programSwitches += o.programSwitches;
+    materialSwitches += o.materialSwitches;
+    uniformUploads += o.uniformUploads;
+    textureBinds += o.textureBinds;
+    bufferMaps += o.bufferMaps;
+    return *this;
+}
+
+GLPipelineStatistics &GLPipelineStatistics::operator+=(const GLPipelineStatistics &o)
+{
+    verticesSubmitted += o.verticesSubmitted;
+    vertexShaderInvocations += o.vertexShaderInvocations;
+    fragmentShaderInvocations += o.fragmentShaderInvocations;
+    computeShaderInvocations += o.computeShaderInvocations;
+    return *this;
+}
+
+GLTaskCounters GLRenderStats::FrameSnapshot::totalCounters() const
+{
+    GLTaskCounters total;
+    for (std::size_t i = 0; i < numTasks; ++i) {
+        total += tasks[i].counters;
+    }
+    return total;
+}
+
+GLPipelineStatistics GLRenderStats::FrameSnapshot::totalPipelineStatistics() const
+{
+    GLPipelineStatistics total;
+    for (std::size_t i = 0; i < numTasks; ++i) {
+        total += tasks[i].pipelineStatistics;
+    }
+    return total;
+}
+
+void GLRenderStats::FrameSnapshot::print(std::ostream &out) const
+{
+    out << "Render stats:" << std::endl;
+    for (std::size_t i = 0; i < numTasks; ++i) {
+        const TaskSnapshot &task = tasks[i];
+        out << "\t" << task.name << ": " << task.counters.draws << " draws, "
+            << task.counters.triangles << " triangles, " << task.counters.dispatches
+            << " dispatches, " << task.counters.programSwitches << " program switches, "
+            << task.counters.materialSwitches << " material switches, "
+            << task.counters.uniformUploads << " uniform uploads, "
+            << task.counters.textureBinds << " texture binds, " << task.counters.bufferMaps
+            << " buffer maps" << std::endl;
+
+        if (hasPipelineStatistics) {
+            out << "\t\t" << task.pipelineStatistics.verticesSubmitted << " vertices, "
+                << task.pipelineStatistics.vertexShaderInvocations << " VS invocations, "
+                << task.pipelineStatistics.fragmentShaderInvocations << " FS invocations, "
+                << task.pipelineStatistics.computeShaderInvocations << " CS invocations"
+                << std::endl;
+        }
+    }
+}
+
+GLRenderStats::TaskScope::TaskScope(GLRenderStats &stats, StringView name)
+    : m_stats(stats), mp_prevCounters(tp_currentCounters), m_taskIndex(NO_TASK),
+      m_frameSerial(stats.m_frameSerial), m_queriesActive(false)
+{
+    if (std::this_thread::get_id() != stats.m_ownerThreadId) {
+        return;
+    }
+
+    Frame &frame = stats.m_frames[stats.m_currentFrameIndex];
+    if (frame.snapshot.numTasks >= MAX_TASKS_PER_FRAME) {
+        return;
+    }
+
+    m_taskIndex = frame.snapshot.numTasks++;
+    TaskSnapshot &task = frame.snapshot.tasks[m_taskIndex];
+    task.name = name;
+    task.counters = {};
+    task.pipelineStatistics = {};
+    tp_currentCounters = &task.counters;
+
+    // statistics queries can't nest, so only the outermost task gets them
+    if (stats.m_pipelineStatistics && stats.m_numActiveTasks == 0) {
+        for (std::size_t q = 0; q < NUM_PIPELINE_QUERIES; ++q) {
+            glBeginQuery(PIPELINE_QUERY_TARGETS[q],
+                         frame.queries[m_taskIndex * NUM_PIPELINE_QUERIES + q]);
+        }
+        m_queriesActive = true;
+    }
+    ++stats.m_numActiveTasks;
+}
+
+GLRenderStats::TaskScope::~TaskScope()
+{
+    if (m_taskIndex == NO_TASK) {
+        return;
+    }
+
+    tp_currentCounters = mp_prevCounters;
+    --m_stats.m_numActiveTasks;
+
+    if (m_queriesActive) {
+        for (std::size_t q = 0; q < NUM_PIPELINE_QUERIES; ++q) {
+            glEndQuery(PIPELINE_QUERY_TARGETS[q]);
+        }
+
+        // the frame could've advanced while the task was running
+        if (m_frameSerial == m_stats.m_frameSerial) {
+            m_stats.m_frames[m_stats.m_currentFrameIndex].queriesIssued[m_taskIndex] = true;
+        }
+    }
+}
+
+GLRenderStats::GLRenderStats(std::size_t numFramesInFlight)
+    : m_frames(numFramesInFlight), m_currentFrameIndex(0), m_frameSerial(0),
+      m_numActiveTasks(0), m_pipelineStatistics(false)
+{
+    for (Frame &frame : m_frames) {
+        frame.queriesIssued.fill(false);
+    }
+}
+
+GLRenderStats::~GLRenderStats() {}
+
+void GLRenderStats::setup(bool pipelineStatistics)
+{
+    m_ownerThreadId = std::this_thread::get_id();
+    m_pipelineStatistics = pipelineStatistics;
+
+    if (m_pipelineStatistics) {
+        for (Frame &frame : m_frames) {
+            frame.queries.resize(MAX_TASKS_PER_FRAME * NUM_PIPELINE_QUERIES);
+            for (std::size_t q = 0; q < NUM_PIPELINE_QUERIES; ++q) {
+                for (std::size_t t = 0; t < MAX_TASKS_PER_FRAME; ++t) {
+                    glCreateQueries(PIPELINE_QUERY_TARGETS[q], 1,
+                                    &frame.queries[t * NUM_PIPELINE_QUERIES + q]);
+                }
+            }
+        }
+    }
+}
+
+void GLRenderStats::free()
+{
+    for (Frame &frame : m_frames) {
+        if (!frame.queries.empty()) {
+            glDeleteQueries(frame.queries.size(), frame.queries.data());
+            frame.queries.clear();
+        }
+    }
+    m_pipelineStatistics = false;
+}
+
+void GLRenderStats::nextFrame()
+{
+    m_currentFrameIndex = (m_currentFrameIndex + 1) % m_frames.size();
+    ++m_frameSerial;
+
+    // the frame we're about to reuse is the oldest one in flight
+    Frame &frame = m_frames[m_currentFrameIndex];
+
+    frame.snapshot.hasPipelineStatistics = m_pipelineStatistics;
+    for (std::size_t t = 0; t < frame.snapshot.numTasks && m_pipelineStatistics; ++t) {
+        if (!frame.queriesIssued[t]) {
+            continue;
+        }
+
+        const GLuint *queries = &frame.queries[t * NUM_PIPELINE_QUERIES];
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(queries[NUM_PIPELINE_QUERIES - 1], GL_QUERY_RESULT_AVAILABLE,
+                           &available);
+        if (!available) {
+            // don't stall; report the frame without GPU statistics
+            frame.snapshot.hasPipelineStatistics = false;
+            break;
+        }
+
+        GLPipelineStatistics &stats = frame.snapshot.tasks[t].pipelineStatistics;
+        glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &stats.verticesSubmitted);
+        glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &stats.vertexShaderInvocations);
+        glGetQueryObjectui64v(queries[2], GL_QUERY_RESULT, &stats.fragmentShaderInvocations);
+        glGetQueryObjectui64v(queries[3], GL_QUERY_RESULT, &stats.computeShaderInvocations);
+    }
+
+    m_lastSnapshot = frame.snapshot;
+
+    frame.snapshot.numTasks = 0;
+    frame.queriesIssued.fill(false);
+}
+
+const GLRenderStats::FrameSnapshot &GLRenderStats::getLastSnapshot() const
+{
+    return m_lastSnapshot;
+}
+
+GLTaskCounters &GLRenderStats::currentCounters()
+{
+    return tp_currentCounters ? *tp_currentCounters : tp_scratchCounters;
+}
+
+} // namespace Vitrae
@@ -0,0 +1,148 @@
+#include "VitraePluginOpenGL/Bits/ShaderArtifacts.hpp"
+
+#include <fstream>
+
+#ifdef VITRAE_PLUGIN_OPENGL_ENABLE_ZLIB
+#include "zlib.h"
+#endif
+
+namespace Vitrae
+{
+
+/*
+Discarder
+*/
+
+bool GLShaderArtifactDiscarder::isEnabled() const
+{
+    return false;
+}
+
+void GLShaderArtifactDiscarder::submit(GLShaderArtifact &&artifact) {}
+
+/*
+Ring
+*/
+
+GLShaderArtifactRing::GLShaderArtifactRing(std::size_t capacity) : m_capacity(capacity) {}
+
+bool GLShaderArtifactRing::isEnabled() const
+{
+    return m_capacity > 0;
+}
+
+void GLShaderArtifactRing::submit(GLShaderArtifact &&artifact)
+{
+    std::unique_lock lock(m_mutex);
+
+    if (m_artifacts.size() >= m_capacity) {
+        m_artifacts.pop_front();
+    }
+    m_artifacts.push_back(std::move(artifact));
+}
+
+std::vector<GLShaderArtifact> GLShaderArtifactRing::getArtifacts() const
+{
+    std::unique_lock lock(m_mutex);
+
+    return std::vector<GLShaderArtifact>(m_artifacts.begin(), m_artifacts.end());
+}
+
+/*
+File writer
+*/
+
+GLShaderArtifactFileWriter::GLShaderArtifactFileWriter(const SetupParams &params)
+    : m_params(params), m_numSubmitted(0), m_numWritten(0), m_flushRequested(false),
+      m_stopping(false)
+{
+    m_writerThread = std::thread([this]() {
+        std::unique_lock lock(m_mutex);
+        while (true) {
+            m_wakeCondition.wait_for(lock, m_params.flushInterval, [this]() {
+                return m_stopping || m_flushRequested || m_queue.size() >= m_params.maxBatchSize;
+            });
+            m_flushRequested = false;
+
+            if (!m_queue.empty()) {
+                std::vector<GLShaderArtifact> batch;
+                batch.swap(m_queue);
+
+                lock.unlock();
+                writeBatch(batch);
+                lock.lock();
+
+                m_numWritten += batch.size();
+                m_writtenCondition.notify_all();
+            } else if (m_stopping) {
+                return;
+            }
+        }
+    });
+}
+
+GLShaderArtifactFileWriter::~GLShaderArtifactFileWriter()
+{
+    {
+        std::unique_lock lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wakeCondition.notify_all();
+    m_writerThread.join();
+}
+
+bool GLShaderArtifactFileWriter::isEnabled() const
+{
+    return true;
+}
+
+void GLShaderArtifactFileWriter::submit(GLShaderArtifact &&artifact)
+{
+    bool batchFull;
+    {
+        std::unique_lock lock(m_mutex);
+        m_queue.push_back(std::move(artifact));
+        ++m_numSubmitted;
+        batchFull = m_queue.size() >= m_params.maxBatchSize;
+    }
+    if (batchFull) {
+        m_wakeCondition.notify_all();
+    }
+}
+
+void GLShaderArtifactFileWriter::flush()
+{
+    std::unique_lock lock(m_mutex);
+    std::size_t target = m_numSubmitted;
+
+    m_flushRequested = true;
+    m_wakeCondition.notify_all();
+    m_writtenCondition.wait(lock, [&]() { return m_numWritten >= target; });
+}
+
+void GLShaderArtifactFileWriter::writeBatch(const std::vector<GLShaderArtifact> &batch) const
+{
+    std::error_code ec;
+    std::filesystem::create_directories(m_params.directory, ec);
+
+#ifdef VITRAE_PLUGIN_OPENGL_ENABLE_ZLIB
+    if (m_params.compress) {
+        for (const GLShaderArtifact &artifact : batch) {
+            std::filesystem::path path = m_params.directory / (artifact.name + ".gz");
+            gzFile file = gzopen(path.string().c_str(), "wb");
+            if (file != nullptr) {
+                gzwrite(file, artifact.content.data(), (unsigned)artifact.content.size());
+                gzclose(file);
+            }
+        }
+        return;
+    }
+#endif
+
+    for (const GLShaderArtifact &artifact : batch) {
+        std::ofstream file(m_params.directory / artifact.name, std::ios::binary | std::ios::trunc);
+        file.write(artifact.content.data(), artifact.content.size());
+    }
+}
+
+} // namespace Vitrae
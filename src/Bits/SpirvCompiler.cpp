@@ -0,0 +1,220 @@
+#include "VitraePluginOpenGL/Bits/SpirvCompiler.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef VITRAE_PLUGIN_OPENGL_ENABLE_SPIRV
+#include "glslang/Public/ResourceLimits.h"
+#include "glslang/Public/ShaderLang.h"
+#include "glslang/SPIRV/GlslangToSpv.h"
+#endif
+
+namespace Vitrae
+{
+
+namespace
+{
+constexpr std::uint32_t SPIRV_MAGIC = 0x07230203;
+
+// bump when the generated modules change for the same source
+constexpr StringView MODULE_FORMAT_ID = "gl460-spv1.0-v1";
+
+// sanity limit, so a corrupt file doesn't allocate gigabytes
+constexpr std::uintmax_t MAX_MODULE_SIZE = 1 << 26;
+
+String computeModuleKey(GLenum shaderType, const String &glslSource)
+{
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    auto fnv1a = [&](StringView data) {
+        for (char c : data) {
+            hash ^= (unsigned char)c;
+            hash *= 0x100000001b3ull;
+        }
+    };
+    fnv1a(MODULE_FORMAT_ID);
+    fnv1a(StringView(reinterpret_cast<const char *>(&shaderType), sizeof(shaderType)));
+    fnv1a(glslSource);
+
+    std::stringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return ss.str();
+}
+
+#ifdef VITRAE_PLUGIN_OPENGL_ENABLE_SPIRV
+EShLanguage getGlslangStage(GLenum shaderType)
+{
+    switch (shaderType) {
+    case GL_VERTEX_SHADER:
+        return EShLangVertex;
+    case GL_TESS_CONTROL_SHADER:
+        return EShLangTessControl;
+    case GL_TESS_EVALUATION_SHADER:
+        return EShLangTessEvaluation;
+    case GL_GEOMETRY_SHADER:
+        return EShLangGeometry;
+    case GL_FRAGMENT_SHADER:
+        return EShLangFragment;
+    case GL_COMPUTE_SHADER:
+        return EShLangCompute;
+    default:
+        throw std::invalid_argument("Shader type not supported by SPIR-V compilation");
+    }
+}
+
+void initializeGlslang()
+{
+    static std::once_flag initFlag;
+    std::call_once(initFlag, []() { glslang::InitializeProcess(); });
+}
+#endif
+} // namespace
+
+/*
+Compiler
+*/
+
+bool GLSpirvCompiler::isAvailable()
+{
+#ifdef VITRAE_PLUGIN_OPENGL_ENABLE_SPIRV
+    return true;
+#else
+    return false;
+#endif
+}
+
+GLSpirvModule GLSpirvCompiler::compile(GLenum shaderType, const String &glslSource)
+{
+#ifdef VITRAE_PLUGIN_OPENGL_ENABLE_SPIRV
+    initializeGlslang();
+
+    EShLanguage stage = getGlslangStage(shaderType);
+    EShMessages messages = (EShMessages)(EShMsgSpvRules | EShMsgDefault);
+    const char *sourcePtr = glslSource.c_str();
+
+    glslang::TShader shader(stage);
+    shader.setStrings(&sourcePtr, 1);
+    shader.setEnvInput(glslang::EShSourceGlsl, stage, glslang::EShClientOpenGL, 100);
+    shader.setEnvClient(glslang::EShClientOpenGL, glslang::EShTargetOpenGL_450);
+    shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_0);
+    if (!shader.parse(GetDefaultResources(), 460, false, messages)) {
+        throw std::runtime_error(String("SPIR-V compilation failed:\n") + shader.getInfoLog());
+    }
+
+    glslang::TProgram program;
+    program.addShader(&shader);
+    if (!program.link(messages)) {
+        throw std::runtime_error(String("SPIR-V linking failed:\n") + program.getInfoLog());
+    }
+
+    GLSpirvModule module;
+    glslang::GlslangToSpv(*program.getIntermediate(stage), module);
+    return module;
+#else
+    throw std::runtime_error("Built without SPIR-V support");
+#endif
+}
+
+/*
+Module cache
+*/
+
+GLSpirvModuleCache::GLSpirvModuleCache() {}
+
+void GLSpirvModuleCache::setup(const std::filesystem::path &directory)
+{
+    std::unique_lock lock(m_mutex);
+
+    m_modules.clear();
+    m_directory.clear();
+
+    if (directory.empty()) {
+        return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (!ec) {
+        m_directory = directory;
+    }
+}
+
+std::shared_ptr<const GLSpirvModule> GLSpirvModuleCache::getModule(GLenum shaderType,
+                                                                   const String &glslSource)
+{
+    String key = computeModuleKey(shaderType, glslSource);
+
+    {
+        std::unique_lock lock(m_mutex);
+        if (auto it = m_modules.find(key); it != m_modules.end()) {
+            return it->second;
+        }
+    }
+
+    // compile outside the lock; racing threads may both compile, but agree on the result
+    std::shared_ptr<const GLSpirvModule> p_module = load(key);
+    if (!p_module) {
+        p_module = std::make_shared<const GLSpirvModule>(
+            GLSpirvCompiler::compile(shaderType, glslSource));
+        store(key, *p_module);
+    }
+
+    std::unique_lock lock(m_mutex);
+    return m_modules.emplace(key, std::move(p_module)).first->second;
+}
+
+std::shared_ptr<const GLSpirvModule> GLSpirvModuleCache::load(const String &key) const
+{
+    if (m_directory.empty()) {
+        return nullptr;
+    }
+
+    std::filesystem::path path = m_directory / (key + ".spv");
+    std::error_code ec;
+    std::uintmax_t size = std::filesystem::file_size(path, ec);
+    if (ec || size == 0 || size % sizeof(std::uint32_t) != 0 || size > MAX_MODULE_SIZE) {
+        return nullptr;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    GLSpirvModule module(size / sizeof(std::uint32_t));
+    if (!file.read(reinterpret_cast<char *>(module.data()), size) ||
+        module[0] != SPIRV_MAGIC) {
+        return nullptr;
+    }
+
+    return std::make_shared<const GLSpirvModule>(std::move(module));
+}
+
+void GLSpirvModuleCache::store(const String &key, const GLSpirvModule &module) const
+{
+    if (m_directory.empty()) {
+        return;
+    }
+
+    // write to a temporary file first, so readers never see a partial module
+    std::stringstream tmpName;
+    tmpName << key << "." << std::this_thread::get_id() << ".tmp";
+    std::filesystem::path tmpPath = m_directory / tmpName.str();
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(module.data()),
+                   module.size() * sizeof(std::uint32_t));
+        if (!file) {
+            file.close();
+            std::error_code ec;
+            std::filesystem::remove(tmpPath, ec);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, m_directory / (key + ".spv"), ec);
+    if (ec) {
+        std::filesystem::remove(tmpPath, ec);
+    }
+}
+
+} // namespace Vitrae
@@ -0,0 +1,401 @@
+#include "VitraePluginOpenGL/Bits/StateCache.hpp"
+#include "VitraePluginOpenGL/Bits/RenderStats.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Vitrae
+{
+
+namespace
+{
+thread_local GLStateCache *tp_currentStateCache = nullptr;
+
+// deletions queued for a context that doesn't make tracked calls, before its whole state is
+// treated as unknown instead
+constexpr std::size_t MAX_FORGOTTEN_OBJECTS = 256;
+} // namespace
+
+GLStateCache::GLStateCache(const std::deque<GLStateCache> &group) : m_group(group) {}
+
+GLStateCache &GLStateCache::current()
+{
+    if (!tp_currentStateCache) {
+        throw std::logic_error("No GL context is enabled on this thread");
+    }
+    return *tp_currentStateCache;
+}
+
+GLStateCache *GLStateCache::tryCurrent() noexcept
+{
+    return tp_currentStateCache;
+}
+
+void GLStateCache::setCurrent(GLStateCache *p_cache)
+{
+    tp_currentStateCache = p_cache;
+}
+
+template <class T> bool GLStateCache::changes(std::optional<T> &cached, const T &newValue)
+{
+    if (m_hasForgotten.load(std::memory_order_acquire)) {
+        applyForgotten();
+    }
+
+    if (cached.has_value() && cached.value() == newValue) {
+        increment(m_skippedCalls);
+        return false;
+    } else {
+        cached = newValue;
+        increment(m_issuedCalls);
+        return true;
+    }
+}
+
+/*
+Object bindings
+*/
+
+void GLStateCache::useProgram(GLuint program)
+{
+    if (changes(m_program, program)) {
+        glUseProgram(program);
+        ++GLRenderStats::currentCounters().programSwitches;
+    }
+}
+
+void GLStateCache::bindProgramPipeline(GLuint pipeline)
+{
+    if (changes(m_programPipeline, pipeline)) {
+        glBindProgramPipeline(pipeline);
+    }
+}
+
+void GLStateCache::activeShaderProgram(GLuint pipeline, GLuint program)
+{
+    if (changes(m_activeShaderProgram, std::make_pair(pipeline, program))) {
+        glActiveShaderProgram(pipeline, program);
+    }
+}
+
+void GLStateCache::bindVertexArray(GLuint vertexArray)
+{
+    if (changes(m_vertexArray, vertexArray)) {
+        glBindVertexArray(vertexArray);
+    }
+}
+
+void GLStateCache::bindTextureUnit(GLuint unit, GLuint texture)
+{
+    if (m_textureUnits.size() <= unit) {
+        m_textureUnits.resize(unit + 1);
+    }
+    if (changes(m_textureUnits[unit], texture)) {
+        glBindTextureUnit(unit, texture);
+        ++GLRenderStats::currentCounters().textureBinds;
+    }
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+    auto it = std::find_if(m_bufferTargets.begin(), m_bufferTargets.end(),
+                           [target](const auto &p) { return p.first == target; });
+    if (it == m_bufferTargets.end()) {
+        it = m_bufferTargets.insert(it, {target, std::nullopt});
+    }
+    if (changes(it->second, buffer)) {
+        glBindBuffer(target, buffer);
+    }
+}
+
+void GLStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    auto it = std::find_if(m_indexedBufferTargets.begin(), m_indexedBufferTargets.end(),
+                           [target](const auto &p) { return p.first == target; });
+    if (it == m_indexedBufferTargets.end()) {
+        it = m_indexedBufferTargets.insert(it, {target, {}});
+    }
+    if (it->second.size() <= index) {
+        it->second.resize(index + 1);
+    }
+    if (changes(it->second[index], buffer)) {
+        glBindBufferBase(target, index, buffer);
+
+        // glBindBufferBase also binds the buffer to the generic binding point
+        auto genericIt = std::find_if(m_bufferTargets.begin(), m_bufferTargets.end(),
+                                      [target](const auto &p) { return p.first == target; });
+        if (genericIt == m_bufferTargets.end()) {
+            m_bufferTargets.emplace_back(target, buffer);
+        } else {
+            genericIt->second = buffer;
+        }
+    }
+}
+
+void GLStateCache::bindFramebuffer(GLuint framebuffer)
+{
+    if (changes(m_framebuffer, framebuffer)) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+}
+
+/*
+Fixed function state
+*/
+
+void GLStateCache::setCapability(GLenum capability, bool enabled)
+{
+    auto it = std::find_if(m_capabilities.begin(), m_capabilities.end(),
+                           [capability](const auto &p) { return p.first == capability; });
+    if (it != m_capabilities.end() && it->second == enabled) {
+        increment(m_skippedCalls);
+        return;
+    }
+
+    if (it == m_capabilities.end()) {
+        m_capabilities.emplace_back(capability, enabled);
+    } else {
+        it->second = enabled;
+    }
+    increment(m_issuedCalls);
+
+    if (enabled) {
+        glEnable(capability);
+    } else {
+        glDisable(capability);
+    }
+}
+
+void GLStateCache::depthFunc(GLenum func)
+{
+    if (changes(m_depthFunc, func)) {
+        glDepthFunc(func);
+    }
+}
+
+void GLStateCache::depthMask(bool enabled)
+{
+    if (changes(m_depthMask, enabled)) {
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+    }
+}
+
+void GLStateCache::cullFace(GLenum mode)
+{
+    if (changes(m_cullFace, mode)) {
+        glCullFace(mode);
+    }
+}
+
+void GLStateCache::blendEquationSeparate(GLenum modeRGB, GLenum modeAlpha)
+{
+    if (changes(m_blendEquation, {modeRGB, modeAlpha})) {
+        glBlendEquationSeparate(modeRGB, modeAlpha);
+    }
+}
+
+void GLStateCache::blendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha,
+                                     GLenum dstAlpha)
+{
+    if (changes(m_blendFunc, {srcRGB, dstRGB, srcAlpha, dstAlpha})) {
+        glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+    }
+}
+
+void GLStateCache::lineWidth(GLfloat width)
+{
+    if (changes(m_lineWidth, width)) {
+        glLineWidth(width);
+    }
+}
+
+void GLStateCache::polygonMode(GLenum mode)
+{
+    if (changes(m_polygonMode, mode)) {
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+    }
+}
+
+void GLStateCache::hint(GLenum target, GLenum mode)
+{
+    auto it = std::find_if(m_hints.begin(), m_hints.end(),
+                           [target](const auto &p) { return p.first == target; });
+    if (it != m_hints.end() && it->second == mode) {
+        increment(m_skippedCalls);
+        return;
+    }
+
+    if (it == m_hints.end()) {
+        m_hints.emplace_back(target, mode);
+    } else {
+        it->second = mode;
+    }
+    increment(m_issuedCalls);
+
+    glHint(target, mode);
+}
+
+void GLStateCache::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if (changes(m_viewport, {x, y, width, height})) {
+        glViewport(x, y, width, height);
+    }
+}
+
+/*
+Object deletion
+*/
+
+void GLStateCache::forgetProgram(GLuint program)
+{
+    forgetForAll(ObjectKind::Program, program);
+}
+
+void GLStateCache::forgetProgramPipeline(GLuint pipeline)
+{
+    forgetForAll(ObjectKind::ProgramPipeline, pipeline);
+}
+
+void GLStateCache::forgetVertexArray(GLuint vertexArray)
+{
+    forgetForAll(ObjectKind::VertexArray, vertexArray);
+}
+
+void GLStateCache::forgetTexture(GLuint texture)
+{
+    forgetForAll(ObjectKind::Texture, texture);
+}
+
+void GLStateCache::forgetBuffer(GLuint buffer)
+{
+    forgetForAll(ObjectKind::Buffer, buffer);
+}
+
+void GLStateCache::forgetFramebuffer(GLuint framebuffer)
+{
+    forgetForAll(ObjectKind::Framebuffer, framebuffer);
+}
+
+void GLStateCache::invalidate()
+{
+    m_program.reset();
+    m_programPipeline.reset();
+    m_activeShaderProgram.reset();
+    m_vertexArray.reset();
+    m_framebuffer.reset();
+    m_textureUnits.clear();
+    m_bufferTargets.clear();
+    m_indexedBufferTargets.clear();
+
+    m_capabilities.clear();
+    m_hints.clear();
+    m_depthFunc.reset();
+    m_depthMask.reset();
+    m_cullFace.reset();
+    m_blendEquation.reset();
+    m_blendFunc.reset();
+    m_lineWidth.reset();
+    m_polygonMode.reset();
+    m_viewport.reset();
+}
+
+GLStateCache::Stats GLStateCache::getStats() const
+{
+    return Stats{
+        .issuedCalls = m_issuedCalls.load(std::memory_order_relaxed),
+        .skippedCalls = m_skippedCalls.load(std::memory_order_relaxed),
+    };
+}
+
+void GLStateCache::resetStats()
+{
+    m_issuedCalls.store(0, std::memory_order_relaxed);
+    m_skippedCalls.store(0, std::memory_order_relaxed);
+}
+
+void GLStateCache::forgetForAll(ObjectKind kind, GLuint name)
+{
+    // The names can get reused, even when the deletion happened in another context
+    for (const GLStateCache &cache : m_group) {
+        const_cast<GLStateCache &>(cache).queueForget(kind, name);
+    }
+}
+
+void GLStateCache::queueForget(ObjectKind kind, GLuint name)
+{
+    std::unique_lock lock(m_forgottenMutex);
+    if (m_forgottenOverflow) {
+        return;
+    }
+    if (m_forgotten.size() >= MAX_FORGOTTEN_OBJECTS) {
+        m_forgotten = {};
+        m_forgottenOverflow = true;
+    } else {
+        m_forgotten.emplace_back(kind, name);
+    }
+    m_hasForgotten.store(true, std::memory_order_release);
+}
+
+void GLStateCache::applyForgotten()
+{
+    std::vector<std::pair<ObjectKind, GLuint>> forgotten;
+    bool overflow;
+    {
+        std::unique_lock lock(m_forgottenMutex);
+        forgotten.swap(m_forgotten);
+        overflow = m_forgottenOverflow;
+        m_forgottenOverflow = false;
+        m_hasForgotten.store(false, std::memory_order_relaxed);
+    }
+
+    if (overflow) {
+        invalidate();
+        return;
+    }
+
+    auto forgetIfEqual = [](std::optional<GLuint> &cached, GLuint name) {
+        if (cached.has_value() && cached.value() == name) {
+            cached.reset();
+        }
+    };
+
+    for (auto [kind, name] : forgotten) {
+        switch (kind) {
+        case ObjectKind::Program:
+            forgetIfEqual(m_program, name);
+            if (m_activeShaderProgram.has_value() && m_activeShaderProgram->second == name) {
+                m_activeShaderProgram.reset();
+            }
+            break;
+        case ObjectKind::ProgramPipeline:
+            forgetIfEqual(m_programPipeline, name);
+            if (m_activeShaderProgram.has_value() && m_activeShaderProgram->first == name) {
+                m_activeShaderProgram.reset();
+            }
+            break;
+        case ObjectKind::VertexArray:
+            forgetIfEqual(m_vertexArray, name);
+            break;
+        case ObjectKind::Texture:
+            for (auto &unit : m_textureUnits) {
+                forgetIfEqual(unit, name);
+            }
+            break;
+        case ObjectKind::Buffer:
+            for (auto &[target, buffer] : m_bufferTargets) {
+                forgetIfEqual(buffer, name);
+            }
+            for (auto &[target, buffers] : m_indexedBufferTargets) {
+                for (auto &buffer : buffers) {
+                    forgetIfEqual(buffer, name);
+                }
+            }
+            break;
+        case ObjectKind::Framebuffer:
+            forgetIfEqual(m_framebuffer, name);
+            break;
+        }
+    }
+}
+
+} // namespace Vitrae
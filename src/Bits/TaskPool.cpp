@@ -0,0 +1,67 @@
+#include "VitraePluginOpenGL/Bits/TaskPool.hpp"
+
+namespace Vitrae
+{
+
+GLTaskPool::GLTaskPool() : m_stopping(false) {}
+
+GLTaskPool::~GLTaskPool()
+{
+    free();
+}
+
+void GLTaskPool::setup(std::size_t numThreads)
+{
+    free();
+
+    m_stopping = false;
+    for (std::size_t i = 0; i < numThreads; ++i) {
+        m_threads.emplace_back([this]() {
+            std::unique_lock lock(m_queueMutex);
+            while (true) {
+                m_queueCondition.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+                if (m_queue.empty()) {
+                    // stopping and nothing left to do
+                    return;
+                }
+
+                std::function<void()> job = std::move(m_queue.front());
+                m_queue.pop_front();
+
+                lock.unlock();
+                job();
+                lock.lock();
+            }
+        });
+    }
+}
+
+void GLTaskPool::free()
+{
+    {
+        std::unique_lock lock(m_queueMutex);
+        m_stopping = true;
+    }
+    m_queueCondition.notify_all();
+
+    for (std::thread &thread : m_threads) {
+        thread.join();
+    }
+    m_threads.clear();
+}
+
+std::size_t GLTaskPool::getNumThreads() const
+{
+    return m_threads.size();
+}
+
+void GLTaskPool::enqueue(std::function<void()> job)
+{
+    {
+        std::unique_lock lock(m_queueMutex);
+        m_queue.push_back(std::move(job));
+    }
+    m_queueCondition.notify_one();
+}
+
+} // namespace Vitrae
@@ -0,0 +1,144 @@
+#include "VitraePluginOpenGL/Bits/TokenizedCode.hpp"
+
+#include <algorithm>
+
+namespace Vitrae
+{
+
+namespace
+{
+bool isIdentifierStart(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool isIdentifierChar(char c)
+{
+    return isIdentifierStart(c) || (c >= '0' && c <= '9');
+}
+
+bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+} // namespace
+
+GLTokenizedCode::GLTokenizedCode(String code, std::span<const String> paramNames)
+    : m_code(std::move(code))
+{
+    std::size_t plainStart = 0;
+    std::size_t i = 0;
+    const std::size_t size = m_code.size();
+
+    // whether only whitespace precedes i on its line, so a '#' starts a directive
+    bool atLineStart = true;
+
+    while (i < size) {
+        char c = m_code[i];
+
+        if (c == '\n') {
+            atLineStart = true;
+            ++i;
+            continue;
+        } else if (c == ' ' || c == '\t' || c == '\r') {
+            ++i;
+            continue;
+        } else if (c == '#' && atLineStart) {
+            // preprocessor directive, up to the end of its line and its continuations;
+            // params in it keep their names and get #defined around the code instead
+            while (i < size && (m_code[i] != '\n' || m_code[i - 1] == '\\')) {
+                if (isIdentifierStart(m_code[i]) && !isIdentifierChar(m_code[i - 1])) {
+                    std::size_t start = i;
+                    while (i < size && isIdentifierChar(m_code[i])) {
+                        ++i;
+                    }
+
+                    StringView identifier(m_code.data() + start, i - start);
+                    auto it = std::find(paramNames.begin(), paramNames.end(), identifier);
+                    if (it != paramNames.end() &&
+                        std::find(m_directiveParamIndices.begin(), m_directiveParamIndices.end(),
+                                  it - paramNames.begin()) == m_directiveParamIndices.end()) {
+                        m_directiveParamIndices.push_back(it - paramNames.begin());
+                        m_directiveParamNames.push_back(*it);
+                    }
+                } else {
+                    ++i;
+                }
+            }
+            continue;
+        }
+        atLineStart = false;
+
+        if (c == '/' && i + 1 < size && m_code[i + 1] == '/') {
+            // line comment
+            i = m_code.find('\n', i);
+            if (i == String::npos) {
+                i = size;
+            }
+        } else if (c == '/' && i + 1 < size && m_code[i + 1] == '*') {
+            // block comment
+            i = m_code.find("*/", i + 2);
+            i = (i == String::npos) ? size : i + 2;
+        } else if (isDigit(c) || (c == '.' && i + 1 < size && isDigit(m_code[i + 1]))) {
+            // number literal, which can contain letters such as in 1.0e-3f or 0xFFu
+            bool isHex = c == '0' && i + 1 < size && (m_code[i + 1] == 'x' || m_code[i + 1] == 'X');
+            ++i;
+            while (i < size) {
+                char prev = m_code[i - 1];
+                if (isIdentifierChar(m_code[i]) || m_code[i] == '.' ||
+                    (!isHex && (m_code[i] == '+' || m_code[i] == '-') &&
+                     (prev == 'e' || prev == 'E'))) {
+                    ++i;
+                } else {
+                    break;
+                }
+            }
+        } else if (isIdentifierStart(c)) {
+            std::size_t start = i;
+            while (i < size && isIdentifierChar(m_code[i])) {
+                ++i;
+            }
+
+            StringView identifier(m_code.data() + start, i - start);
+            auto it = std::find(paramNames.begin(), paramNames.end(), identifier);
+            if (it != paramNames.end()) {
+                if (start > plainStart) {
+                    m_segments.push_back({plainStart, start - plainStart, -1});
+                }
+                m_segments.push_back({start, i - start, it - paramNames.begin()});
+                plainStart = i;
+            }
+        } else {
+            ++i;
+        }
+    }
+
+    if (size > plainStart) {
+        m_segments.push_back({plainStart, size - plainStart, -1});
+    }
+}
+
+void GLTokenizedCode::write(std::ostream &output, std::span<const String> replacements) const
+{
+    for (std::size_t i = 0; i < m_directiveParamIndices.size(); ++i) {
+        output << "#define " << m_directiveParamNames[i] << " "
+               << replacements[m_directiveParamIndices[i]] << "\n";
+    }
+
+    for (const Segment &segment : m_segments) {
+        if (segment.paramIndex < 0) {
+            output.write(m_code.data() + segment.offset, segment.length);
+        } else {
+            output << replacements[segment.paramIndex];
+        }
+    }
+
+    if (!m_directiveParamIndices.empty()) {
+        output << "\n";
+        for (const String &name : m_directiveParamNames) {
+            output << "#undef " << name << "\n";
+        }
+    }
+}
+
+} // namespace Vitrae
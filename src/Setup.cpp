@@ -26,11 +26,11 @@
 namespace VitraePluginOpenGL
 {
 
-void setup(Vitrae::ComponentRoot &root)
+void setup(Vitrae::ComponentRoot &root, const Vitrae::OpenGLRenderer::SetupParams &params)
 {
     using namespace Vitrae;
 
-    root.setComponent<Renderer>(new OpenGLRenderer(root));
+    root.setComponent<Renderer>(new OpenGLRenderer(root, params));
 
     // clang-format off
     root.setComponent<              MeshKeeper>(new  dynasma::NaiveKeeper<              MeshKeeperSeed, std::allocator<              OpenGLMesh>>());
@@ -49,6 +49,33 @@ void setup(Vitrae::ComponentRoot &root)
     root.setComponent<ComposeClearRenderKeeper>(new  dynasma::NaiveKeeper<ComposeClearRenderKeeperSeed, std::allocator<OpenGLComposeClearRender>>());
     root.setComponent<CompiledGLSLShaderCacher>(new  dynasma::BasicCacher<CompiledGLSLShaderCacherSeed, std::allocator<      CompiledGLSLShader>>());
     // clang-format on
+
+    switch (params.shaderArtifactLevel) {
+    case GLShaderArtifactLevel::Off:
+        root.setComponent<GLShaderArtifactSink>(new GLShaderArtifactDiscarder());
+        break;
+    case GLShaderArtifactLevel::Ring:
+        root.setComponent<GLShaderArtifactSink>(
+            new GLShaderArtifactRing(params.shaderArtifactRingCapacity));
+        break;
+    case GLShaderArtifactLevel::AsyncFile:
+        root.setComponent<GLShaderArtifactSink>(
+            new GLShaderArtifactFileWriter(params.shaderArtifactFiles));
+        break;
+    }
+
+    // unused assets get freed, cheapest to recreate first, when over the video memory budget
+    GLMemoryLedger &memoryLedger =
+        static_cast<OpenGLRenderer &>(root.getComponent<Renderer>()).getMemoryLedger();
+    memoryLedger.addEvictor([&root](std::size_t bytes) {
+        return root.getComponent<CompiledGLSLShaderCacher>().clean(bytes);
+    });
+    memoryLedger.addEvictor([&root](std::size_t bytes) {
+        return root.getComponent<FrameStoreManager>().clean(bytes);
+    });
+    memoryLedger.addEvictor([&root](std::size_t bytes) {
+        return root.getComponent<TextureManager>().clean(bytes);
+    });
 }
 
 } // namespace VitraePluginOpenGL
\ No newline at end of file
@@ -75,13 +75,17 @@ void OpenGLComposeClearRender::run(RenderComposeContext args) const
 {
     MMETER_SCOPE_PROFILER(m_friendlyName.c_str());
 
+    OpenGLRenderer &rend = static_cast<OpenGLRenderer &>(m_root.getComponent<Renderer>());
+    GLGpuTimer::Scope gpuScope(rend.getGpuTimer(), m_friendlyName);
+    GLRenderStats::TaskScope statsScope(rend.getRenderStats(), m_friendlyName);
+
     dynasma::FirmPtr<FrameStore> p_frame =
         args.properties.get(StandardParam::fs_target.name).get<dynasma::FirmPtr<FrameStore>>();
     OpenGLFrameStore &frame = static_cast<OpenGLFrameStore &>(*p_frame);
 
     frame.enterRender({0.0f, 0.0f}, {1.0f, 1.0f});
 
-    glDepthMask(GL_TRUE);
+    GLStateCache::current().depthMask(true);
     GLbitfield clearMask = 0;
 
     std::size_t attachmentIndex = 0;
@@ -138,6 +138,8 @@ void OpenGLComposeCompute::run(RenderComposeContext args) const
     }
 
     OpenGLRenderer &rend = static_cast<OpenGLRenderer &>(m_params.root.getComponent<Renderer>());
+    GLGpuTimer::Scope gpuScope(rend.getGpuTimer(), m_friendlyName);
+    GLRenderStats::TaskScope statsScope(rend.getRenderStats(), m_friendlyName);
     CompiledGLSLShaderCacher &shaderCacher = m_params.root.getComponent<CompiledGLSLShaderCacher>();
 
     // get invocation count
@@ -148,11 +150,7 @@ void OpenGLComposeCompute::run(RenderComposeContext args) const
         m_params.computeSetup.groupSizeZ.get(args.properties),
     };
 
-    glm::ivec3 decidedGroupSize = {
-        specifiedGroupSize.x == GROUP_SIZE_AUTO ? 64 : specifiedGroupSize.x,
-        specifiedGroupSize.y == GROUP_SIZE_AUTO ? 1 : specifiedGroupSize.y,
-        specifiedGroupSize.z == GROUP_SIZE_AUTO ? 1 : specifiedGroupSize.z,
-    };
+    glm::ivec3 decidedGroupSize = decideGroupSize(specifiedGroupSize, rend.getCapabilities());
 
     // compile shader for this compute execution
     dynasma::FirmPtr<CompiledGLSLShader> p_compiledShader =
@@ -161,8 +159,9 @@ void OpenGLComposeCompute::run(RenderComposeContext args) const
             m_params.computeSetup.invocationCountX, m_params.computeSetup.invocationCountY,
             m_params.computeSetup.invocationCountZ, decidedGroupSize,
             m_params.computeSetup.allowOutOfBoundsCompute)});
+    p_compiledShader->waitUntilReady();
 
-    glUseProgram(p_compiledShader->programGLName);
+    p_compiledShader->use();
 
     // set uniforms
     p_compiledShader->setupProperties(rend, args.properties.getUnaliasedScope());
@@ -176,6 +175,7 @@ void OpenGLComposeCompute::run(RenderComposeContext args) const
     glDispatchCompute((invocationCount.x + decidedGroupSize.x - 1) / decidedGroupSize.x,
                       (invocationCount.y + decidedGroupSize.y - 1) / decidedGroupSize.y,
                       (invocationCount.z + decidedGroupSize.z - 1) / decidedGroupSize.z);
+    ++GLRenderStats::currentCounters().dispatches;
 
     // the outputs should be the same pointers as inputs
     /// TODO: allow non-SSBO outputs
@@ -197,6 +197,58 @@ StringView OpenGLComposeCompute::getFriendlyName() const
     return m_friendlyName;
 }
 
+void OpenGLComposeCompute::warmUp(CompiledGLSLShaderWarmUp &warmUp,
+                                  const ParamAliases &aliases) const
+{
+    const auto &computeSetup = m_params.computeSetup;
+    if (!computeSetup.groupSizeX.isFixed() || !computeSetup.groupSizeY.isFixed() ||
+        !computeSetup.groupSizeZ.isFixed()) {
+        return;
+    }
+
+    OpenGLRenderer &rend = static_cast<OpenGLRenderer &>(m_params.root.getComponent<Renderer>());
+
+    glm::ivec3 specifiedGroupSize = {
+        computeSetup.groupSizeX.getFixedValue(),
+        computeSetup.groupSizeY.getFixedValue(),
+        computeSetup.groupSizeZ.getFixedValue(),
+    };
+
+    // run() will report the invalid group size, so don't build a program for it
+    glm::ivec3 decidedGroupSize;
+    try {
+        decidedGroupSize = decideGroupSize(specifiedGroupSize, rend.getCapabilities());
+    }
+    catch (std::exception &e) {
+        m_params.root.getErrStream()
+            << "During OpenGLComposeCompute warm-up: " << e.what() << std::endl;
+        return;
+    }
+
+    warmUp.addComputeShader(aliases, m_params.iterationOutputSpecs, computeSetup.invocationCountX,
+                            computeSetup.invocationCountY, computeSetup.invocationCountZ,
+                            decidedGroupSize, computeSetup.allowOutOfBoundsCompute);
+}
+
+glm::ivec3 OpenGLComposeCompute::decideGroupSize(glm::ivec3 specifiedGroupSize,
+                                                 const GLCapabilities &caps)
+{
+    glm::ivec3 autoGroupSize = caps.getAutoComputeGroupSize();
+    glm::ivec3 decidedGroupSize = {
+        specifiedGroupSize.x == GROUP_SIZE_AUTO ? autoGroupSize.x : specifiedGroupSize.x,
+        specifiedGroupSize.y == GROUP_SIZE_AUTO ? autoGroupSize.y : specifiedGroupSize.y,
+        specifiedGroupSize.z == GROUP_SIZE_AUTO ? autoGroupSize.z : specifiedGroupSize.z,
+    };
+
+    if (glm::any(glm::greaterThan(decidedGroupSize, caps.maxComputeWorkGroupSize)) ||
+        decidedGroupSize.x * decidedGroupSize.y * decidedGroupSize.z >
+            caps.maxComputeWorkGroupInvocations) {
+        throw std::runtime_error("Compute group size exceeds the implementation limits");
+    }
+
+    return decidedGroupSize;
+}
+
 OpenGLComposeCompute::ProgramPerAliases &OpenGLComposeCompute::getProgramPerAliases(
     const ParamAliases &aliases) const
 {
@@ -94,6 +94,8 @@ void OpenGLComposeDataRender::run(RenderComposeContext args) const
     MMETER_SCOPE_PROFILER(m_friendlyName.c_str());
 
     OpenGLRenderer &rend = static_cast<OpenGLRenderer &>(m_root.getComponent<Renderer>());
+    GLGpuTimer::Scope gpuScope(rend.getGpuTimer(), m_friendlyName);
+    GLRenderStats::TaskScope statsScope(rend.getRenderStats(), m_friendlyName);
     CompiledGLSLShaderCacher &shaderCacher = m_root.getComponent<CompiledGLSLShaderCacher>();
 
     // Get specs cache and init it if needed
@@ -145,9 +147,9 @@ void OpenGLComposeDataRender::run(RenderComposeContext args) const
 
     // Compile and setup the shader
     dynasma::FirmPtr<CompiledGLSLShader> p_compiledShader;
-    GLint glModelMatrixUniformLocation;
-    GLint glMVPMatrixUniformLocation;
-    GLint glDisplayMatrixUniformLocation;
+    std::span<const CompiledGLSLShader::UniformTarget> glModelMatrixUniformTargets;
+    std::span<const CompiledGLSLShader::UniformTarget> glMVPMatrixUniformTargets;
+    std::span<const CompiledGLSLShader::UniformTarget> glDisplayMatrixUniformTargets;
 
     {
         MMETER_SCOPE_PROFILER("Shader setup");
@@ -158,7 +160,8 @@ void OpenGLComposeDataRender::run(RenderComposeContext args) const
 
             p_compiledShader = shaderCacher.retrieve_asset({CompiledGLSLShader::SurfaceShaderParams(
                 combinedAliases, m_params.rasterizing.vertexPositionOutputPropertyName,
-                *frame.getRenderComponents(), m_root)});
+                *frame.getRenderComponents(), m_root, *rend.getMaterialSpecialization(*p_mat))});
+            p_compiledShader->waitUntilReady();
 
             // Aliases should've already been taken into account, so use properties directly
             VariantScope &directProperties = args.properties.getUnaliasedScope();
@@ -173,26 +176,14 @@ void OpenGLComposeDataRender::run(RenderComposeContext args) const
                 throw ComposeTaskRequirementsChangedException();
             }
 
-            if (auto it = p_compiledShader->uniformSpecs.find(StandardParam::mat_model.name);
-                it != p_compiledShader->uniformSpecs.end()) {
-                glModelMatrixUniformLocation = (*it).second.location;
-            } else {
-                glModelMatrixUniformLocation = -1;
-            }
-            if (auto it = p_compiledShader->uniformSpecs.find(StandardParam::mat_display.name);
-                it != p_compiledShader->uniformSpecs.end()) {
-                glDisplayMatrixUniformLocation = (*it).second.location;
-            } else {
-                glDisplayMatrixUniformLocation = -1;
-            }
-            if (auto it = p_compiledShader->uniformSpecs.find(StandardParam::mat_mvp.name);
-                it != p_compiledShader->uniformSpecs.end()) {
-                glMVPMatrixUniformLocation = (*it).second.location;
-            } else {
-                glMVPMatrixUniformLocation = -1;
-            }
+            glModelMatrixUniformTargets =
+                p_compiledShader->getUniformTargets(StandardParam::mat_model.name);
+            glDisplayMatrixUniformTargets =
+                p_compiledShader->getUniformTargets(StandardParam::mat_display.name);
+            glMVPMatrixUniformTargets =
+                p_compiledShader->getUniformTargets(StandardParam::mat_mvp.name);
 
-            glUseProgram(p_compiledShader->programGLName);
+            p_compiledShader->use();
         }
 
         // Aliases should've already been taken into account, so use properties directly
@@ -229,22 +220,30 @@ void OpenGLComposeDataRender::run(RenderComposeContext args) const
 
             // run the data generator
 
-            RenderCallback renderCallback = [glModelMatrixUniformLocation,
-                                             glDisplayMatrixUniformLocation,
-                                             glMVPMatrixUniformLocation, &mat_display, p_shape,
+            RenderCallback renderCallback = [glModelMatrixUniformTargets,
+                                             glDisplayMatrixUniformTargets,
+                                             glMVPMatrixUniformTargets, &mat_display, p_shape,
                                              &rend,
                                              &m_params = m_params](const glm::mat4 &transform) {
-                if (glModelMatrixUniformLocation != -1) {
-                    glUniformMatrix4fv(glModelMatrixUniformLocation, 1, GL_FALSE,
-                                       &(transform[0][0]));
+                GLTaskCounters &counters = GLRenderStats::currentCounters();
+
+                for (auto &target : glModelMatrixUniformTargets) {
+                    glProgramUniformMatrix4fv(target.programGLName, target.location, 1, GL_FALSE,
+                                              &(transform[0][0]));
+                    ++counters.uniformUploads;
                 }
-                if (glDisplayMatrixUniformLocation != -1) {
-                    glUniformMatrix4fv(glDisplayMatrixUniformLocation, 1, GL_FALSE,
-                                       &(mat_display[0][0]));
+                for (auto &target : glDisplayMatrixUniformTargets) {
+                    glProgramUniformMatrix4fv(target.programGLName, target.location, 1, GL_FALSE,
+                                              &(mat_display[0][0]));
+                    ++counters.uniformUploads;
                 }
-                if (glMVPMatrixUniformLocation != -1) {
+                if (!glMVPMatrixUniformTargets.empty()) {
                     glm::mat4 mat_mvp = mat_display * transform;
-                    glUniformMatrix4fv(glMVPMatrixUniformLocation, 1, GL_FALSE, &(mat_mvp[0][0]));
+                    for (auto &target : glMVPMatrixUniformTargets) {
+                        glProgramUniformMatrix4fv(target.programGLName, target.location, 1,
+                                                  GL_FALSE, &(mat_mvp[0][0]));
+                        ++counters.uniformUploads;
+                    }
                 }
 
                 rasterizeShape(*p_shape, m_params.rasterizing);
@@ -252,8 +251,6 @@ void OpenGLComposeDataRender::run(RenderComposeContext args) const
 
             m_params.dataGenerator(args, renderCallback);
 
-            glUseProgram(0);
-
             frame.exitRender();
             break;
         }
@@ -94,6 +94,8 @@ void OpenGLComposeIndexRender::run(RenderComposeContext ctx) const
     MMETER_SCOPE_PROFILER(m_friendlyName.c_str());
 
     OpenGLRenderer &rend = static_cast<OpenGLRenderer &>(m_params.root.getComponent<Renderer>());
+    GLGpuTimer::Scope gpuScope(rend.getGpuTimer(), m_friendlyName);
+    GLRenderStats::TaskScope statsScope(rend.getRenderStats(), m_friendlyName);
     CompiledGLSLShaderCacher &shaderCacher = m_params.root.getComponent<CompiledGLSLShaderCacher>();
 
     // Get specs cache and init it if needed
@@ -141,7 +143,7 @@ void OpenGLComposeIndexRender::run(RenderComposeContext ctx) const
 
     // Compile and setup the shader
     dynasma::FirmPtr<CompiledGLSLShader> p_compiledShader;
-    GLint gl_index4data_UniformLocation;
+    std::span<const CompiledGLSLShader::UniformTarget> gl_index4data_UniformTargets;
 
     {
         MMETER_SCOPE_PROFILER("Shader setup");
@@ -152,7 +154,9 @@ void OpenGLComposeIndexRender::run(RenderComposeContext ctx) const
 
             p_compiledShader = shaderCacher.retrieve_asset({CompiledGLSLShader::SurfaceShaderParams(
                 combinedAliases, m_params.rasterizing.vertexPositionOutputPropertyName,
-                *frame.getRenderComponents(), m_params.root)});
+                *frame.getRenderComponents(), m_params.root,
+                *rend.getMaterialSpecialization(*p_mat))});
+            p_compiledShader->waitUntilReady();
 
             // Aliases should've already been taken into account, so use properties directly
             VariantScope &directProperties = ctx.properties.getUnaliasedScope();
@@ -167,14 +171,10 @@ void OpenGLComposeIndexRender::run(RenderComposeContext ctx) const
                 throw ComposeTaskRequirementsChangedException();
             }
 
-            if (auto it = p_compiledShader->uniformSpecs.find(StandardParam::index4data.name);
-                it != p_compiledShader->uniformSpecs.end()) {
-                    gl_index4data_UniformLocation = (*it).second.location;
-            } else {
-                gl_index4data_UniformLocation = -1;
-            }
+            gl_index4data_UniformTargets =
+                p_compiledShader->getUniformTargets(StandardParam::index4data.name);
 
-            glUseProgram(p_compiledShader->programGLName);
+            p_compiledShader->use();
         }
 
         // Aliases should've already been taken into account, so use properties directly
@@ -210,15 +210,14 @@ void OpenGLComposeIndexRender::run(RenderComposeContext ctx) const
             stateSetupRasterizing(m_params.rasterizing);
 
             for (std::uint32_t i = 0; i < indexSize; ++i) {
-                if (gl_index4data_UniformLocation != -1) {
-                    glUniform1ui(gl_index4data_UniformLocation, i);
+                for (auto &target : gl_index4data_UniformTargets) {
+                    glProgramUniform1ui(target.programGLName, target.location, i);
+                    ++GLRenderStats::currentCounters().uniformUploads;
                 }
 
                 rasterizeShape(*p_shape, m_params.rasterizing);
             }
 
-            glUseProgram(0);
-
             frame.exitRender();
             break;
         }
@@ -140,28 +140,11 @@ void OpenGLComposeSceneRender::run(RenderComposeContext args) const
     MMETER_SCOPE_PROFILER(m_friendlyName.c_str());
 
     OpenGLRenderer &rend = static_cast<OpenGLRenderer &>(m_root.getComponent<Renderer>());
+    GLGpuTimer::Scope gpuScope(rend.getGpuTimer(), m_friendlyName);
+    GLRenderStats::TaskScope statsScope(rend.getRenderStats(), m_friendlyName);
     CompiledGLSLShaderCacher &shaderCacher = m_root.getComponent<CompiledGLSLShaderCacher>();
 
-    // Get specs cache and init it if needed
-    std::size_t specsKey = getSpecsKey(args.aliases);
-    auto specsIt = m_specsPerKey.find(specsKey);
-    if (specsIt == m_specsPerKey.end()) {
-        specsIt = m_specsPerKey.emplace(specsKey, new SpecsPerAliases()).first;
-        SpecsPerAliases &specsContainer = *(*specsIt).second;
-
-        for (auto &tokenName : m_params.inputTokenNames) {
-            specsContainer.inputSpecs.insert_back({.name = tokenName, .typeInfo = TYPE_INFO<void>});
-        }
-
-        specsContainer.inputSpecs.insert_back(StandardParam::scene);
-        specsContainer.filterSpecs.insert_back(StandardParam::fs_target);
-
-        specsContainer.inputSpecs.merge(m_params.ordering.inputSpecs);
-        specsContainer.consumingSpecs.merge(m_params.ordering.consumingSpecs);
-        specsContainer.filterSpecs.merge(m_params.ordering.filterSpecs);
-    }
-
-    SpecsPerAliases &specsContainer = *(*specsIt).second;
+    SpecsPerAliases &specsContainer = getSpecsPerAliases(args.aliases);
 
     // extract common inputs
     Scene &scene = *args.properties.get(StandardParam::scene.name).get<dynasma::FirmPtr<Scene>>();
@@ -221,11 +204,16 @@ void OpenGLComposeSceneRender::run(RenderComposeContext args) const
             // render the scene
             // iterate over shaders
             dynasma::FirmPtr<const Material> p_currentMaterial;
+            std::optional<GLGpuTimer::Scope> materialGpuScope;
             dynasma::FirmPtr<CompiledGLSLShader> p_currentShader;
             std::size_t currentShaderHash = 0;
-            GLint glModelMatrixUniformLocation;
-            GLint glMVPMatrixUniformLocation;
-            GLint glDisplayMatrixUniformLocation;
+            // the material whose properties are used; differs while the program is compiling
+            dynasma::FirmPtr<const Material> p_drawnMaterial;
+            bool usingFallbackShader = false;
+            bool skipDraws = false;
+            std::span<const CompiledGLSLShader::UniformTarget> glModelMatrixUniformTargets;
+            std::span<const CompiledGLSLShader::UniformTarget> glMVPMatrixUniformTargets;
+            std::span<const CompiledGLSLShader::UniformTarget> glDisplayMatrixUniformTargets;
 
             for (auto p_modelProp : sortedModelProps) {
                 // Setup the shape to render
@@ -262,13 +250,26 @@ void OpenGLComposeSceneRender::run(RenderComposeContext args) const
 
                     p_currentMaterial = p_nextMaterial;
 
-                    if (p_currentMaterial->getParamAliases().hash() != currentShaderHash) {
+                    // time each batch of draws sharing a material
+                    materialGpuScope.reset();
+                    materialGpuScope.emplace(rend.getGpuTimer(), "Material batch");
+                    ++GLRenderStats::currentCounters().materialSwitches;
+
+                    p_drawnMaterial = usingFallbackShader ? rend.getFallbackMaterial().value()
+                                                          : p_currentMaterial;
+
+                    std::shared_ptr<const GLProgramSpecialization> p_specialization =
+                        rend.getMaterialSpecialization(*p_currentMaterial);
+                    std::size_t nextShaderHash = combinedHashes<2>(
+                        {{p_currentMaterial->getParamAliases().hash(), p_specialization->hash}});
+
+                    if (nextShaderHash != currentShaderHash) {
                         MMETER_SCOPE_PROFILER("Shader change");
 
                         {
                             MMETER_SCOPE_PROFILER("Shader loading");
 
-                            currentShaderHash = p_currentMaterial->getParamAliases().hash();
+                            currentShaderHash = nextShaderHash;
 
                             const ParamAliases *p_aliaseses[] = {
                                 &p_currentMaterial->getParamAliases(), &args.aliases};
@@ -278,39 +279,56 @@ void OpenGLComposeSceneRender::run(RenderComposeContext args) const
                             p_currentShader = shaderCacher.retrieve_asset(
                                 {CompiledGLSLShader::SurfaceShaderParams(
                                     aliases, m_params.rasterizing.vertexPositionOutputPropertyName,
-                                    *frame.getRenderComponents(), m_root)});
+                                    *frame.getRenderComponents(), m_root, *p_specialization)});
 
                             // Store pipeline property specs
+                            if (mergeShaderSpecs(specsContainer, *p_currentShader,
+                                                 *p_currentMaterial)) {
+                                needsRebuild = true;
+                            }
+                        }
 
-                            using ListConvPair = std::pair<const ParamList *, ParamList *>;
-
-                            for (auto [p_specs, p_targetSpecs] :
-                                 {ListConvPair{&p_currentShader->inputSpecs,
-                                               &specsContainer.inputSpecs},
-                                  ListConvPair{&p_currentShader->filterSpecs,
-                                               &specsContainer.filterSpecs},
-                                  ListConvPair{&p_currentShader->consumingSpecs,
-                                               &specsContainer.consumingSpecs}}) {
-                                for (auto [nameId, spec] : p_specs->getMappedSpecs()) {
-                                    if (p_currentMaterial->getProperties().find(nameId) ==
-                                            p_currentMaterial->getProperties().end() &&
-                                        nameId != StandardParam::mat_model.name &&
-                                        nameId != StandardParam::mat_display.name &&
-                                        nameId != StandardParam::mat_mvp.name &&
-                                        p_targetSpecs->getMappedSpecs().find(nameId) ==
-                                            p_targetSpecs->getMappedSpecs().end()) {
-                                        p_targetSpecs->insert_back(spec);
-                                        needsRebuild = true;
-                                    }
+                        // programs that are still compiling get replaced or skipped
+                        p_drawnMaterial = p_currentMaterial;
+                        usingFallbackShader = false;
+                        skipDraws = false;
+                        if (!p_currentShader->isReady()) {
+                            switch (rend.getParams().pendingProgramPolicy) {
+                            case GLPendingProgramPolicy::Wait:
+                                p_currentShader->waitUntilReady();
+                                break;
+                            case GLPendingProgramPolicy::Fallback:
+                                if (rend.getFallbackMaterial().has_value()) {
+                                    MMETER_SCOPE_PROFILER("Fallback shader loading");
+
+                                    const ParamAliases *p_aliaseses[] = {
+                                        &rend.getFallbackMaterial().value()->getParamAliases(),
+                                        &args.aliases};
+
+                                    ParamAliases aliases(p_aliaseses);
+
+                                    p_currentShader = shaderCacher.retrieve_asset(
+                                        {CompiledGLSLShader::SurfaceShaderParams(
+                                            aliases,
+                                            m_params.rasterizing.vertexPositionOutputPropertyName,
+                                            *frame.getRenderComponents(), m_root)});
+                                    p_currentShader->waitUntilReady();
+                                    p_drawnMaterial = rend.getFallbackMaterial().value();
+                                    usingFallbackShader = true;
+                                    break;
                                 }
+                                [[fallthrough]];
+                            case GLPendingProgramPolicy::Skip:
+                                skipDraws = true;
+                                break;
                             }
                         }
 
-                        if (!needsRebuild) {
+                        if (!needsRebuild && !skipDraws) {
                             MMETER_SCOPE_PROFILER("Shader setup");
 
                             // OpenGL - use the program
-                            glUseProgram(p_currentShader->programGLName);
+                            p_currentShader->use();
 
                             // Aliases should've already been taken into account, so use
                             // properties directly
@@ -318,35 +336,20 @@ void OpenGLComposeSceneRender::run(RenderComposeContext args) const
 
                             // set the 'environmental' uniforms
                             // skip those that will be set by the material
-                            if (auto it = p_currentShader->uniformSpecs.find(
-                                    StandardParam::mat_model.name);
-                                it != p_currentShader->uniformSpecs.end()) {
-                                glModelMatrixUniformLocation = (*it).second.location;
-                            } else {
-                                glModelMatrixUniformLocation = -1;
-                            }
-                            if (auto it = p_currentShader->uniformSpecs.find(
-                                    StandardParam::mat_display.name);
-                                it != p_currentShader->uniformSpecs.end()) {
-                                glDisplayMatrixUniformLocation = (*it).second.location;
-                            } else {
-                                glDisplayMatrixUniformLocation = -1;
-                            }
-                            if (auto it =
-                                    p_currentShader->uniformSpecs.find(StandardParam::mat_mvp.name);
-                                it != p_currentShader->uniformSpecs.end()) {
-                                glMVPMatrixUniformLocation = (*it).second.location;
-                            } else {
-                                glMVPMatrixUniformLocation = -1;
-                            }
+                            glModelMatrixUniformTargets =
+                                p_currentShader->getUniformTargets(StandardParam::mat_model.name);
+                            glDisplayMatrixUniformTargets =
+                                p_currentShader->getUniformTargets(StandardParam::mat_display.name);
+                            glMVPMatrixUniformTargets =
+                                p_currentShader->getUniformTargets(StandardParam::mat_mvp.name);
 
                             p_currentShader->setupNonMaterialProperties(rend, directProperties,
-                                                                        *p_currentMaterial);
+                                                                        *p_drawnMaterial);
                         }
                     }
 
-                    if (!needsRebuild) {
-                        p_currentShader->setupMaterialProperties(rend, *p_currentMaterial);
+                    if (!needsRebuild && !skipDraws) {
+                        p_currentShader->setupMaterialProperties(rend, *p_drawnMaterial);
                     }
                 }
 
@@ -358,28 +361,31 @@ void OpenGLComposeSceneRender::run(RenderComposeContext args) const
                     p_shape->loadToGPU(rend);
                 }
 
-                if (!needsRebuild) {
+                if (!needsRebuild && !skipDraws) {
                     MMETER_SCOPE_PROFILER("Mesh draw");
 
-                    if (glModelMatrixUniformLocation != -1) {
-                        glUniformMatrix4fv(glModelMatrixUniformLocation, 1, GL_FALSE,
-                                           &(mat_model[0][0]));
+                    GLTaskCounters &counters = GLRenderStats::currentCounters();
+
+                    for (auto &target : glModelMatrixUniformTargets) {
+                        glProgramUniformMatrix4fv(target.programGLName, target.location, 1,
+                                                  GL_FALSE, &(mat_model[0][0]));
+                        ++counters.uniformUploads;
                     }
-                    if (glDisplayMatrixUniformLocation != -1) {
-                        glUniformMatrix4fv(glDisplayMatrixUniformLocation, 1, GL_FALSE,
-                                           &(mat_display[0][0]));
+                    for (auto &target : glDisplayMatrixUniformTargets) {
+                        glProgramUniformMatrix4fv(target.programGLName, target.location, 1,
+                                                  GL_FALSE, &(mat_display[0][0]));
+                        ++counters.uniformUploads;
                     }
-                    if (glMVPMatrixUniformLocation != -1) {
-                        glUniformMatrix4fv(glMVPMatrixUniformLocation, 1, GL_FALSE,
-                                           &(mat_mvp[0][0]));
+                    for (auto &target : glMVPMatrixUniformTargets) {
+                        glProgramUniformMatrix4fv(target.programGLName, target.location, 1,
+                                                  GL_FALSE, &(mat_mvp[0][0]));
+                        ++counters.uniformUploads;
                     }
 
                     rasterizeShape(*p_shape, m_params.rasterizing);
                 }
             }
 
-            glUseProgram(0);
-
             frame.exitRender();
             break;
         }
@@ -414,4 +420,90 @@ std::size_t OpenGLComposeSceneRender::getSpecsKey(const ParamAliases &aliases) c
           aliases.hash()}});
 }
 
+OpenGLComposeSceneRender::SpecsPerAliases &OpenGLComposeSceneRender::getSpecsPerAliases(
+    const ParamAliases &aliases) const
+{
+    // Get specs cache and init it if needed
+    std::size_t specsKey = getSpecsKey(aliases);
+    auto specsIt = m_specsPerKey.find(specsKey);
+    if (specsIt == m_specsPerKey.end()) {
+        specsIt = m_specsPerKey.emplace(specsKey, new SpecsPerAliases()).first;
+        SpecsPerAliases &specsContainer = *(*specsIt).second;
+
+        for (auto &tokenName : m_params.inputTokenNames) {
+            specsContainer.inputSpecs.insert_back({.name = tokenName, .typeInfo = TYPE_INFO<void>});
+        }
+
+        specsContainer.inputSpecs.insert_back(StandardParam::scene);
+        specsContainer.filterSpecs.insert_back(StandardParam::fs_target);
+
+        specsContainer.inputSpecs.merge(m_params.ordering.inputSpecs);
+        specsContainer.consumingSpecs.merge(m_params.ordering.consumingSpecs);
+        specsContainer.filterSpecs.merge(m_params.ordering.filterSpecs);
+    }
+
+    return *(*specsIt).second;
+}
+
+bool OpenGLComposeSceneRender::mergeShaderSpecs(SpecsPerAliases &specsContainer,
+                                                const CompiledGLSLShader &shader,
+                                                const Material &material) const
+{
+    bool anyMissing = false;
+
+    using ListConvPair = std::pair<const ParamList *, ParamList *>;
+
+    for (auto [p_specs, p_targetSpecs] :
+         {ListConvPair{&shader.inputSpecs, &specsContainer.inputSpecs},
+          ListConvPair{&shader.filterSpecs, &specsContainer.filterSpecs},
+          ListConvPair{&shader.consumingSpecs, &specsContainer.consumingSpecs}}) {
+        for (auto [nameId, spec] : p_specs->getMappedSpecs()) {
+            if (material.getProperties().find(nameId) == material.getProperties().end() &&
+                nameId != StandardParam::mat_model.name &&
+                nameId != StandardParam::mat_display.name &&
+                nameId != StandardParam::mat_mvp.name &&
+                p_targetSpecs->getMappedSpecs().find(nameId) ==
+                    p_targetSpecs->getMappedSpecs().end()) {
+                p_targetSpecs->insert_back(spec);
+                anyMissing = true;
+            }
+        }
+    }
+
+    return anyMissing;
+}
+
+void OpenGLComposeSceneRender::warmUp(CompiledGLSLShaderWarmUp &warmUp, const Scene &scene,
+                                      const FrameStore &frame, const ParamAliases &aliases) const
+{
+    MMETER_FUNC_PROFILER;
+
+    OpenGLRenderer &rend = static_cast<OpenGLRenderer &>(m_root.getComponent<Renderer>());
+    SpecsPerAliases &specsContainer = getSpecsPerAliases(aliases);
+    const ParamList &fragmentOutputs =
+        *static_cast<const OpenGLFrameStore &>(frame).getRenderComponents();
+
+    // one program per distinct material aliases and specialization, as in run()
+    std::set<std::size_t> queuedShaderHashes;
+    for (auto &modelProp : scene.modelProps) {
+        dynasma::FirmPtr<const Material> p_material = modelProp.p_model->getMaterial();
+        std::shared_ptr<const GLProgramSpecialization> p_specialization =
+            rend.getMaterialSpecialization(*p_material);
+        std::size_t shaderHash =
+            combinedHashes<2>({{p_material->getParamAliases().hash(), p_specialization->hash}});
+
+        if (queuedShaderHashes.insert(shaderHash).second) {
+            const ParamAliases *p_aliaseses[] = {&p_material->getParamAliases(), &aliases};
+
+            warmUp.addSurfaceShader(
+                warmUp.keepAliases(ParamAliases(p_aliaseses)),
+                m_params.rasterizing.vertexPositionOutputPropertyName, fragmentOutputs,
+                [this, &specsContainer, p_material](CompiledGLSLShader &shader) {
+                    mergeShaderSpecs(specsContainer, shader, *p_material);
+                },
+                *p_specialization);
+        }
+    }
+}
+
 } // namespace Vitrae
\ No newline at end of file
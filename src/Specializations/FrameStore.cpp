@@ -30,8 +30,8 @@ OpenGLFrameStore::OpenGLFrameStore(const FrameStore::TextureBindParams &params)
 
     GLuint glFramebufferId;
 
-    glGenFramebuffers(1, &glFramebufferId);
-    glBindFramebuffer(GL_FRAMEBUFFER, glFramebufferId);
+    // DSA, so the bound framebuffer known to the state cache doesn't change
+    glCreateFramebuffers(1, &glFramebufferId);
 
     int width = 0, height = 0;
 
@@ -68,13 +68,12 @@ OpenGLFrameStore::OpenGLFrameStore(const FrameStore::TextureBindParams &params)
                    },
                    texSpec.shaderComponent);
 
-        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, p_texture->glTextureId,
-                               0);
+        glNamedFramebufferTexture(glFramebufferId, attachment, p_texture->glTextureId, 0);
     }
 
-    glDrawBuffers(m_colorAttachmentUnusedIndex, drawBufferConstantsOrdered);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glNamedFramebufferDrawBuffers(glFramebufferId, m_colorAttachmentUnusedIndex,
+                                  drawBufferConstantsOrdered);
+    glNamedFramebufferReadBuffer(glFramebufferId, GL_NONE);
 
     String glLabel = String("FB ") + String(params.friendlyName);
     glObjectLabel(GL_FRAMEBUFFER, glFramebufferId, glLabel.size(), glLabel.data());
@@ -89,6 +88,10 @@ OpenGLFrameStore::OpenGLFrameStore(const WindowDisplayParams &params)
 {
     OpenGLRenderer &rend = static_cast<OpenGLRenderer &>(params.root.getComponent<Renderer>());
 
+    if (rend.isHeadless()) {
+        throw std::runtime_error("Can't create a window FrameStore with a headless renderer");
+    }
+
     GLFWwindow *window = rend.getWindow();
 
     // reset window
@@ -149,8 +152,28 @@ OpenGLFrameStore::~OpenGLFrameStore()
 
 std::size_t OpenGLFrameStore::memory_cost() const
 {
-    return sizeof(OpenGLFrameStore);
+    std::size_t cost = sizeof(OpenGLFrameStore);
+
+    std::visit(Overloaded{
+                   [&](const FramebufferContextSwitcher &contextSwitcher) {
+                       // the attached textures are kept alive by this FrameStore
+                       for (const auto &texSpec : m_outputTextureSpecs) {
+                           if (texSpec.p_texture.has_value()) {
+                               cost += texSpec.p_texture.value()->memory_cost();
+                           }
+                       }
+                   },
+                   [&](const WindowContextSwitcher &contextSwitcher) {
+                       // double buffered RGBA8 color and a 32-bit depth buffer, owned by the driver
+                       glm::uvec2 size = contextSwitcher.getSize();
+                       cost += (std::size_t)size.x * size.y * (4 * 2 + 4);
+                   },
+               },
+               m_contextSwitcher);
+
+    return cost;
 }
+
 void OpenGLFrameStore::resize(glm::vec2 size)
 {
     /// TODO: resize capabilities
@@ -163,8 +186,6 @@ void OpenGLFrameStore::bindOutput(const OutputTextureSpec &texSpec)
     std::visit(
         Overloaded{
             [&](FramebufferContextSwitcher &contextSwitcher) {
-                glBindFramebuffer(GL_FRAMEBUFFER, contextSwitcher.glFramebufferId);
-
                 if (!texSpec.p_texture.has_value()) {
                     return;
                 }
@@ -196,8 +217,8 @@ void OpenGLFrameStore::bindOutput(const OutputTextureSpec &texSpec)
                            },
                            texSpec.shaderComponent);
 
-                glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D,
-                                       p_texture->glTextureId, 0);
+                glNamedFramebufferTexture(contextSwitcher.glFramebufferId, attachment,
+                                          p_texture->glTextureId, 0);
 
                 // re-setup outputs
                 mp_renderComponents =
@@ -205,9 +226,10 @@ void OpenGLFrameStore::bindOutput(const OutputTextureSpec &texSpec)
                         m_renderComponents);
 
                 // re-setup the buffer
-                glDrawBuffers(m_colorAttachmentUnusedIndex, drawBufferConstantsOrdered);
-                glReadBuffer(GL_NONE);
-                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                glNamedFramebufferDrawBuffers(contextSwitcher.glFramebufferId,
+                                              m_colorAttachmentUnusedIndex,
+                                              drawBufferConstantsOrdered);
+                glNamedFramebufferReadBuffer(contextSwitcher.glFramebufferId, GL_NONE);
             },
             [&](WindowContextSwitcher &contextSwitcher) {
                 throw std::runtime_error("Can't bind texture outputs to a window FrameStore");
@@ -256,6 +278,9 @@ Framebuffer drawing
 
 void OpenGLFrameStore::FramebufferContextSwitcher::destroyContext()
 {
+    if (GLStateCache *p_stateCache = GLStateCache::tryCurrent()) {
+        p_stateCache->forgetFramebuffer(glFramebufferId);
+    }
     glDeleteFramebuffers(1, &glFramebufferId);
 }
 glm::uvec2 OpenGLFrameStore::FramebufferContextSwitcher::getSize() const
@@ -265,13 +290,14 @@ glm::uvec2 OpenGLFrameStore::FramebufferContextSwitcher::getSize() const
 void OpenGLFrameStore::FramebufferContextSwitcher::enterContext(glm::vec2 topLeft,
                                                                 glm::vec2 bottomRight)
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, glFramebufferId);
-    glViewport(topLeft.x * width, topLeft.y * height, (bottomRight.x - topLeft.x) * width,
-               (bottomRight.y - topLeft.y) * height);
+    GLStateCache &state = GLStateCache::current();
+    state.bindFramebuffer(glFramebufferId);
+    state.viewport(topLeft.x * width, topLeft.y * height, (bottomRight.x - topLeft.x) * width,
+                   (bottomRight.y - topLeft.y) * height);
 }
 void OpenGLFrameStore::FramebufferContextSwitcher::exitContext()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::current().bindFramebuffer(0);
 }
 
 void OpenGLFrameStore::FramebufferContextSwitcher::sync(bool vsync) {}
@@ -292,8 +318,10 @@ void OpenGLFrameStore::WindowContextSwitcher::enterContext(glm::vec2 topLeft, gl
     int width, height;
     glfwGetFramebufferSize(window, &width, &height);
 
-    glViewport(topLeft.x * width, topLeft.y * height, (bottomRight.x - topLeft.x) * width,
-               (bottomRight.y - topLeft.y) * height);
+    GLStateCache &state = GLStateCache::current();
+    state.bindFramebuffer(0);
+    state.viewport(topLeft.x * width, topLeft.y * height, (bottomRight.x - topLeft.x) * width,
+                   (bottomRight.y - topLeft.y) * height);
 }
 void OpenGLFrameStore::WindowContextSwitcher::exitContext() {}
 
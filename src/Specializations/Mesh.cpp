@@ -9,6 +9,7 @@
 #include "Vitrae/TypeConversion/StringCvt.hpp"
 
 #include <map>
+#include <set>
 #include <vector>
 
 namespace Vitrae
@@ -142,10 +143,10 @@ void OpenGLMesh::loadToGPU(Renderer &r)
 
     if (!m_sentToGPU) {
         // prepare OpenGL buffers
-        glGenVertexArrays(1, &VAO);
+        // (DSA, so the bound VAO known to the state cache doesn't change)
+        glCreateVertexArrays(1, &VAO);
 
         // load vertices
-        glBindVertexArray(VAO);
 
         for (auto [name, p_buffer] : m_vertexComponentBuffers) {
             OpenGLRawSharedBuffer &rawBuffer =
@@ -185,15 +186,17 @@ void OpenGLMesh::loadToGPU(Renderer &r)
 
             // send to OpenGL
             std::size_t layoutInd = rend.getVertexBufferLayoutIndex(name);
-            glBindBuffer(GL_ARRAY_BUFFER, rawBuffer.getGlBufferHandle());
-            glVertexAttribPointer(layoutInd,                        // layout pos
-                                  numSubComponents,                 // data structure info
-                                  scalarSpec.glTypeId,              //
-                                  scalarSpec.isNormalized,          //
-                                  p_buffer.getBytesStride(),        // data subbuffer location info
-                                  (void *)p_buffer.getBytesOffset() //
+            glVertexArrayVertexBuffer(VAO, layoutInd,                // binding index
+                                      rawBuffer.getGlBufferHandle(), //
+                                      p_buffer.getBytesOffset(),     // data subbuffer location
+                                      p_buffer.getBytesStride()      //
             );
-            glEnableVertexAttribArray(layoutInd);
+            glVertexArrayAttribFormat(VAO, layoutInd,      // layout pos
+                                      numSubComponents,    // data structure info
+                                      scalarSpec.glTypeId, //
+                                      scalarSpec.isNormalized, 0);
+            glVertexArrayAttribBinding(VAO, layoutInd, layoutInd);
+            glEnableVertexArrayAttrib(VAO, layoutInd);
         }
 
         OpenGLRawSharedBuffer &rawIndexBuffer =
@@ -203,9 +206,7 @@ void OpenGLMesh::loadToGPU(Renderer &r)
             throw std::runtime_error("Mesh index buffer for " + String(m_friendlyname) +
                                      " is not synchronized");
         }
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, rawIndexBuffer.getGlBufferHandle());
-
-        glBindVertexArray(0);
+        glVertexArrayElementBuffer(VAO, rawIndexBuffer.getGlBufferHandle());
 
         // debug
         String glLabel = String("mesh ") + String(m_friendlyname);
@@ -219,10 +220,33 @@ void OpenGLMesh::unloadFromGPU()
 {
     if (m_sentToGPU) {
         m_sentToGPU = false;
+        if (GLStateCache *p_stateCache = GLStateCache::tryCurrent()) {
+            p_stateCache->forgetVertexArray(VAO);
+        }
         glDeleteVertexArrays(1, &VAO);
     }
 }
 
+std::size_t OpenGLMesh::memory_cost() const
+{
+    std::size_t cost = sizeof(*this);
+
+    // components can be sub-buffers of the same buffer, so count each buffer once
+    std::set<const RawSharedBuffer *> countedBuffers;
+    auto countBuffer = [&](const RawSharedBuffer &rawBuffer) {
+        if (countedBuffers.insert(&rawBuffer).second) {
+            cost += rawBuffer.memory_cost();
+        }
+    };
+
+    for (auto [name, p_buffer] : m_vertexComponentBuffers) {
+        countBuffer(*(p_buffer.getRawBuffer()));
+    }
+    countBuffer(*(m_indexBuffer.getRawBuffer()));
+
+    return cost;
+}
+
 FrontSideOrientation OpenGLMesh::getFrontSideOrientation() const
 {
     return m_frontSideOrientation;
@@ -253,8 +277,12 @@ SharedBufferPtr<void, Triangle> OpenGLMesh::getIndexBuffer() const
 void OpenGLMesh::rasterize() const
 {
     if (m_sentToGPU) {
-        glBindVertexArray(VAO);
+        GLStateCache::current().bindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, 3 * m_indexBuffer.numElements(), GL_UNSIGNED_INT, 0);
+
+        GLTaskCounters &counters = GLRenderStats::currentCounters();
+        ++counters.draws;
+        counters.triangles += m_indexBuffer.numElements();
     }
 }
 
@@ -1,6 +1,7 @@
 #include "VitraePluginOpenGL/Specializations/Renderer.hpp"
 
 #include "VitraePluginOpenGL/Bits/Naming.hpp"
+#include "VitraePluginOpenGL/Specializations/ShaderCompilation.hpp"
 #include "VitraePluginOpenGL/Specializations/Shading/Snippet.hpp"
 #include "VitraePluginOpenGL/Specializations/SharedBuffer.hpp"
 #include "VitraePluginOpenGL/Specializations/Texture.hpp"
@@ -18,9 +19,26 @@
 // must be after glad.h
 #include "GLFW/glfw3.h"
 
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
 namespace Vitrae
 {
-OpenGLRenderer::OpenGLRenderer(ComponentRoot &root) : m_root(root), m_vertexBufferFreeIndex(0)
+OpenGLRenderer::OpenGLRenderer(ComponentRoot &root) : OpenGLRenderer(root, SetupParams{}) {}
+
+OpenGLRenderer::OpenGLRenderer(ComponentRoot &root, const SetupParams &params)
+    : m_root(root), m_params(params),
+      m_gpuTimer(params.gpuTimingFramesInFlight, params.gpuTimingMaxScopesPerFrame),
+      m_renderStats(params.gpuTimingFramesInFlight), m_usesSpirvPrograms(false),
+      m_usesSeparablePrograms(false),
+      mp_shaderPrebuilds(std::make_unique<CompiledGLSLShaderPrebuilds>(*this)),
+      mp_programRegistry(std::make_unique<CompiledGLSLProgramRegistry>()),
+      mp_pipelineMemo(std::make_unique<CompiledGLSLPipelineMemo>(params.maxMemoizedPipelines)),
+      m_staticMaterialPropertyIds(params.staticMaterialProperties.begin(),
+                                  params.staticMaterialProperties.end()),
+      m_vertexBufferFreeIndex(0)
 {
     /*
     Standard GLSL ypes
@@ -89,8 +107,8 @@ OpenGLRenderer::OpenGLRenderer(ComponentRoot &root) : m_root(root), m_vertexBuff
                             .setOpaqueBinding = [](int bindingIndex, const Variant &hostValue) {
                                 auto p_tex = hostValue.get<dynasma::FirmPtr<Texture>>();
                                 OpenGLTexture &tex = static_cast<OpenGLTexture &>(*p_tex);
-                                glActiveTexture(GL_TEXTURE0 + bindingIndex);
-                                glBindTexture(GL_TEXTURE_2D, tex.glTextureId);
+                                GLStateCache::current().bindTextureUnit(bindingIndex,
+                                                                        tex.glTextureId);
                             }});
 
     /*
@@ -110,22 +128,20 @@ void APIENTRY globalDebugCallback(GLenum source, GLenum type, GLuint id, GLenum
 {
     const ComponentRoot &root = *reinterpret_cast<const ComponentRoot *>(userParam);
 
-    switch (type) {
-    case GL_DEBUG_TYPE_ERROR:
-        root.getErrStream() << "OpenGL error: " << message << std::endl;
-        break;
-    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
-        root.getErrStream() << "OpenGL deprecated behavior: " << message << std::endl;
-        break;
-    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
-        root.getErrStream() << "OpenGL undefined behavior: " << message << std::endl;
-        break;
-    case GL_DEBUG_TYPE_PORTABILITY:
-        root.getErrStream() << "OpenGL portability issue: " << message << std::endl;
-        break;
-    case GL_DEBUG_TYPE_PERFORMANCE:
-        root.getErrStream() << "OpenGL performance issue: " << message << std::endl;
-        break;
+    if (const char *description = getGLDebugTypeDescription(type)) {
+        root.getErrStream() << description << ": " << message << std::endl;
+    }
+}
+
+void APIENTRY aggregatingDebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                       GLsizei length, const GLchar *message,
+                                       const void *userParam)
+{
+    GLDebugAggregator &aggregator =
+        *const_cast<GLDebugAggregator *>(reinterpret_cast<const GLDebugAggregator *>(userParam));
+
+    if (getGLDebugTypeDescription(type)) {
+        aggregator.record(type, id, message, length);
     }
 }
 } // namespace
@@ -134,72 +150,683 @@ void OpenGLRenderer::mainThreadSetup(ComponentRoot &root)
 {
     // threading stuff
     m_mainThreadId = std::this_thread::get_id();
-    m_contextMutex.lock();
 
-    glfwInit();
+    // the main thread keeps the context for its whole lifetime, unless the setup fails
+    std::unique_lock contextLock(m_contextMutex);
 
-    glfwWindowHint(GLFW_DOUBLEBUFFER, GLFW_TRUE);
+#ifdef GLFW_PLATFORM_NULL
+    if (isHeadless()) {
+        // there is no display server to connect to, GLFW only manages the context
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+#else
+    if (isHeadless()) {
+        root.getWarningStream() << "Headless contexts need GLFW 3.4 or newer to run without a "
+                                   "display server; this GLFW will still connect to one"
+                                << std::endl;
+    }
+#endif
+
+    if (glfwInit() != GLFW_TRUE) {
+        throw std::runtime_error("Failed to initialize GLFW");
+    }
 
     /*
     Main window
     */
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
-    mp_mainWindow = glfwCreateWindow(640, 480, "", nullptr, nullptr);
+    if (m_params.diagnosticLevel == GLDiagnosticLevel::Production) {
+        // ignored by GLFW if the implementation lacks KHR_no_error
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_FALSE);
+        glfwWindowHint(GLFW_CONTEXT_NO_ERROR, GLFW_TRUE);
+    } else {
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+    }
+
+    switch (m_params.contextMode) {
+    case GLContextMode::Windowed:
+        glfwWindowHint(GLFW_DOUBLEBUFFER, GLFW_TRUE);
+        break;
+    case GLContextMode::HeadlessEGL:
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+        break;
+    case GLContextMode::HeadlessOSMesa:
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+        break;
+    }
+
+    if (isHeadless()) {
+        // The window only hosts the context; everything is rendered into FrameStore textures
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_DOUBLEBUFFER, GLFW_FALSE);
+        mp_mainWindow = glfwCreateWindow(1, 1, "", nullptr, nullptr);
+    } else {
+        mp_mainWindow = glfwCreateWindow(640, 480, "", nullptr, nullptr);
+    }
+
     if (mp_mainWindow == nullptr) {
-        fprintf(stderr, "Failed to Create OpenGL Context");
-        exit(EXIT_FAILURE);
+        const char *description = nullptr;
+        glfwGetError(&description);
+
+        glfwTerminate();
+        throw std::runtime_error(String("Failed to create OpenGL context: ") +
+                                 (description ? description : "unknown error"));
     }
     glfwMakeContextCurrent(mp_mainWindow);
     gladLoadGL(); // seems we need to do this after setting the first context... for whatev reason
 
+    GLStateCache &mainStateCache = m_stateCaches.emplace_back(m_stateCaches);
+    m_waitedWorkerFenceSerials.emplace(mp_mainWindow, 0);
+
     /*
-    List extensions
+    Capabilities
     */
-    GLint no_of_extensions = 0;
-    glGetIntegerv(GL_NUM_EXTENSIONS, &no_of_extensions);
-
-    root.getInfoStream() << "OpenGL extensions:" << std::endl;
-    for (int i = 0; i < no_of_extensions; ++i)
-        root.getInfoStream() << "\t" << (const char *)glGetStringi(GL_EXTENSIONS, i) << std::endl;
-    root.getInfoStream() << "OpenGL end of extensions" << std::endl;
+    m_capabilities = GLCapabilities::query();
+    m_capabilities.print(root.getInfoStream());
 
     /*
     Error handling
     */
-    glDebugMessageCallback(globalDebugCallback, &root);
+    if (m_params.diagnosticLevel == GLDiagnosticLevel::Aggregated) {
+        mp_debugAggregator = std::make_unique<GLDebugAggregator>(root.getErrStream(),
+                                                                 m_params.debugFlushInterval);
+    }
+    setupDebugOutput(root);
+
+    /*
+    Profiling
+    */
+    if (m_params.gpuTiming) {
+        m_gpuTimer.setup();
+    }
+    m_renderStats.setup(m_params.pipelineStatistics &&
+                        m_capabilities.hasPipelineStatisticsQuery);
+
+    // leave headroom for the driver and other applications
+    m_memoryLedger.setBudget(m_params.vramBudget != 0
+                                 ? m_params.vramBudget
+                                 : m_capabilities.dedicatedVideoMemory / 10 * 9);
+
+    /*
+    Program binary cache
+    */
+    m_programBinaryCache.setup(m_params.programBinaryCacheDir, m_capabilities);
+    if (!m_params.programBinaryCacheDir.empty() && !m_programBinaryCache.isEnabled()) {
+        root.getWarningStream() << "Program binary cache at " << m_params.programBinaryCacheDir
+                                << " is unavailable; compiling all programs from source"
+                                << std::endl;
+    }
+
+    /*
+    Shader building
+    */
+    m_shaderBuildPool.setup(m_params.numShaderBuildThreads);
+
+    m_usesSpirvPrograms = m_params.spirvPrograms && m_capabilities.hasSpirV &&
+                          GLSpirvCompiler::isAvailable();
+    if (m_params.spirvPrograms && !m_usesSpirvPrograms) {
+        root.getWarningStream() << "SPIR-V programs are unsupported "
+                                << (GLSpirvCompiler::isAvailable() ? "by the driver"
+                                                                   : "by this build")
+                                << "; compiling all programs from GLSL" << std::endl;
+    }
+    m_spirvModuleCache.setup(m_params.spirvModuleCacheDir);
+
+    m_usesSeparablePrograms = m_params.separablePrograms && m_capabilities.hasSeparateShaderObjects;
+    if (m_params.separablePrograms && !m_usesSeparablePrograms) {
+        root.getWarningStream() << "Separable programs are unsupported by the driver; "
+                                   "linking whole programs instead"
+                                << std::endl;
+    }
+
+    /*
+    Worker contexts
+    */
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    for (std::size_t i = 0; i < m_params.numWorkerContexts; ++i) {
+        GLFWwindow *p_workerWindow = glfwCreateWindow(1, 1, "", nullptr, mp_mainWindow);
+        if (p_workerWindow == nullptr) {
+            root.getWarningStream() << "Failed to create shared worker context; using "
+                                    << m_workerContexts.size() << " instead of "
+                                    << m_params.numWorkerContexts << std::endl;
+            break;
+        }
+
+        glfwMakeContextCurrent(p_workerWindow);
+        setupDebugOutput(root);
+
+        WorkerContext workerContext{
+            .p_window = p_workerWindow,
+            .p_stateCache = &m_stateCaches.emplace_back(m_stateCaches),
+        };
+        m_workerContexts.push_back(workerContext);
+        m_freeWorkerContexts.push_back(workerContext);
+        m_waitedWorkerFenceSerials.emplace(p_workerWindow, 0);
+    }
+    glfwMakeContextCurrent(mp_mainWindow);
+    GLStateCache::setCurrent(&mainStateCache);
+
+    // one thread per worker context, so queued GL jobs never wait for the main context
+    m_workerContextPool.setup(m_workerContexts.size());
+
+    contextLock.release();
 }
 
 void OpenGLRenderer::mainThreadFree()
 {
+    m_workerContextPool.free();
+    waitForWorkerFences(mp_mainWindow);
+    m_shaderBuildPool.free();
+    // drop the builds that never got picked up
+    mp_shaderPrebuilds = std::make_unique<CompiledGLSLShaderPrebuilds>(*this);
+    m_gpuTimer.free();
+    m_renderStats.free();
+    mp_fallbackMaterial.reset();
+
+    for (const WorkerFence &fence : m_workerFences) {
+        glDeleteSync(fence.sync);
+    }
+    m_workerFences.clear();
+    m_waitedWorkerFenceSerials.clear();
+
     glfwMakeContextCurrent(0);
+    GLStateCache::setCurrent(nullptr);
+    for (WorkerContext &workerContext : m_workerContexts) {
+        glfwDestroyWindow(workerContext.p_window);
+    }
+    m_workerContexts.clear();
+    m_freeWorkerContexts.clear();
+
     glfwDestroyWindow(mp_mainWindow);
     glfwTerminate();
+
+    // after the contexts are gone, so no callbacks can arrive anymore
+    mp_debugAggregator.reset();
 }
 
 void OpenGLRenderer::mainThreadUpdate()
 {
     glfwPollEvents();
+
+    waitForWorkerFences(mp_mainWindow);
+    replaySubmittedCommands();
+
+    m_gpuTimer.nextFrame();
+    m_renderStats.nextFrame();
+    m_memoryLedger.enforceBudget();
+
+    {
+        std::unique_lock lock(m_specializationMutex);
+        ++m_specializationFrame;
+
+        // forget the materials that weren't drawn lately, as some may be gone
+        if (m_materialSpecializations.size() > m_materialSpecializationPruneSize) {
+            std::erase_if(m_materialSpecializations, [this](const auto &matSpecializationPair) {
+                return matSpecializationPair.second.lastFrame + 1 < m_specializationFrame;
+            });
+            m_materialSpecializationPruneSize =
+                std::max<std::size_t>(64, m_materialSpecializations.size() * 2);
+        }
+    }
 }
 
 void OpenGLRenderer::anyThreadEnable()
 {
+    // Non-main threads get their own shared context if one is free
+    if (std::this_thread::get_id() != m_mainThreadId) {
+        std::unique_lock lock(m_workerContextMutex);
+
+        if (!m_freeWorkerContexts.empty()) {
+            enableFreeWorkerContext(lock);
+            return;
+        }
+    }
+
+    // Otherwise share the main context
     m_contextMutex.lock();
     glfwMakeContextCurrent(mp_mainWindow);
+    GLStateCache::setCurrent(&m_stateCaches.front());
+    waitForWorkerFences(mp_mainWindow);
 }
 
 void OpenGLRenderer::anyThreadDisable()
 {
+    if (std::this_thread::get_id() != m_mainThreadId) {
+        std::unique_lock lock(m_workerContextMutex);
+
+        if (auto it = m_workerContextsByThread.find(std::this_thread::get_id());
+            it != m_workerContextsByThread.end()) {
+            WorkerContext workerContext = it->second;
+            m_workerContextsByThread.erase(it);
+            lock.unlock();
+
+            // The main context must not use the created objects before the commands finish
+            GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+            glfwMakeContextCurrent(0);
+            GLStateCache::setCurrent(nullptr);
+
+            lock.lock();
+            m_workerFences.push_back({.serial = ++m_lastWorkerFenceSerial, .sync = fence});
+            m_freeWorkerContexts.push_back(workerContext);
+            m_freeWorkerContextCondition.notify_one();
+            return;
+        }
+    }
+
     glfwMakeContextCurrent(0);
+    GLStateCache::setCurrent(nullptr);
     m_contextMutex.unlock();
 }
 
+std::size_t OpenGLRenderer::getNumWorkerContexts() const
+{
+    return m_workerContexts.size();
+}
+
+void OpenGLRenderer::submitCommands(GLCommandBuffer &&buffer)
+{
+    m_commandQueue.submit(std::move(buffer));
+}
+
+void OpenGLRenderer::replaySubmittedCommands()
+{
+    m_commandQueue.replayAll();
+}
+
+GLStateCache &OpenGLRenderer::getMainStateCache()
+{
+    return m_stateCaches.front();
+}
+
+GLStateCache::Stats OpenGLRenderer::getStateCacheStats() const
+{
+    GLStateCache::Stats stats;
+    for (const GLStateCache &cache : m_stateCaches) {
+        GLStateCache::Stats cacheStats = cache.getStats();
+        stats.issuedCalls += cacheStats.issuedCalls;
+        stats.skippedCalls += cacheStats.skippedCalls;
+    }
+    return stats;
+}
+
+void OpenGLRenderer::enableFreeWorkerContext(std::unique_lock<std::mutex> &workerContextLock)
+{
+    WorkerContext workerContext = m_freeWorkerContexts.back();
+    m_freeWorkerContexts.pop_back();
+    m_workerContextsByThread.emplace(std::this_thread::get_id(), workerContext);
+    workerContextLock.unlock();
+
+    glfwMakeContextCurrent(workerContext.p_window);
+    GLStateCache::setCurrent(workerContext.p_stateCache);
+    waitForWorkerFences(workerContext.p_window);
+}
+
+void OpenGLRenderer::waitForWorkerFences(GLFWwindow *p_window)
+{
+    std::unique_lock lock(m_workerContextMutex);
+
+    // Server-side waits; the CPU doesn't block
+    std::uint64_t &waitedSerial = m_waitedWorkerFenceSerials[p_window];
+    for (const WorkerFence &fence : m_workerFences) {
+        if (fence.serial > waitedSerial) {
+            glWaitSync(fence.sync, 0, GL_TIMEOUT_IGNORED);
+        }
+    }
+    waitedSerial = m_lastWorkerFenceSerial;
+
+    // A fence is done once every context waited for it, or once it got signaled anyway
+    std::uint64_t minWaitedSerial = waitedSerial;
+    for (auto [p_otherWindow, otherWaitedSerial] : m_waitedWorkerFenceSerials) {
+        minWaitedSerial = std::min(minWaitedSerial, otherWaitedSerial);
+    }
+    std::erase_if(m_workerFences, [&](const WorkerFence &fence) {
+        GLint status = GL_UNSIGNALED;
+        if (fence.serial > minWaitedSerial) {
+            glGetSynciv(fence.sync, GL_SYNC_STATUS, 1, nullptr, &status);
+        }
+        if (fence.serial <= minWaitedSerial || status == GL_SIGNALED) {
+            glDeleteSync(fence.sync);
+            return true;
+        }
+        return false;
+    });
+}
+
+void OpenGLRenderer::setupDebugOutput(ComponentRoot &root)
+{
+    switch (m_params.diagnosticLevel) {
+    case GLDiagnosticLevel::Production:
+        break;
+    case GLDiagnosticLevel::Aggregated:
+        glDebugMessageCallback(aggregatingDebugCallback, mp_debugAggregator.get());
+        break;
+    case GLDiagnosticLevel::Verbose:
+        glDebugMessageCallback(globalDebugCallback, &root);
+        break;
+    }
+}
+
 GLFWwindow *OpenGLRenderer::getWindow()
 {
     return mp_mainWindow;
 }
 
+const OpenGLRenderer::SetupParams &OpenGLRenderer::getParams() const
+{
+    return m_params;
+}
+
+void OpenGLRenderer::setFallbackMaterial(dynasma::FirmPtr<const Material> p_material)
+{
+    mp_fallbackMaterial = p_material;
+}
+
+const std::optional<dynasma::FirmPtr<const Material>> &OpenGLRenderer::getFallbackMaterial() const
+{
+    return mp_fallbackMaterial;
+}
+
+const GLCapabilities &OpenGLRenderer::getCapabilities() const
+{
+    return m_capabilities;
+}
+
+GLGpuTimer &OpenGLRenderer::getGpuTimer()
+{
+    return m_gpuTimer;
+}
+
+GLRenderStats &OpenGLRenderer::getRenderStats()
+{
+    return m_renderStats;
+}
+
+GLMemoryLedger &OpenGLRenderer::getMemoryLedger()
+{
+    return m_memoryLedger;
+}
+
+const GLProgramBinaryCache &OpenGLRenderer::getProgramBinaryCache() const
+{
+    return m_programBinaryCache;
+}
+
+GLTaskPool &OpenGLRenderer::getShaderBuildPool()
+{
+    return m_shaderBuildPool;
+}
+
+std::future<void> OpenGLRenderer::runOnWorkerContext(std::function<void()> job)
+{
+    return m_workerContextPool.submit([this, job = std::move(job)]() {
+        {
+            std::unique_lock lock(m_workerContextMutex);
+            m_freeWorkerContextCondition.wait(lock,
+                                              [this]() { return !m_freeWorkerContexts.empty(); });
+            enableFreeWorkerContext(lock);
+        }
+
+        try {
+            job();
+        } catch (...) {
+            anyThreadDisable();
+            throw;
+        }
+        anyThreadDisable();
+    });
+}
+
+bool OpenGLRenderer::usesSpirvPrograms() const
+{
+    return m_usesSpirvPrograms;
+}
+
+bool OpenGLRenderer::usesSeparablePrograms() const
+{
+    return m_usesSeparablePrograms;
+}
+
+GLSpirvModuleCache &OpenGLRenderer::getSpirvModuleCache()
+{
+    return m_spirvModuleCache;
+}
+
+CompiledGLSLShaderPrebuilds &OpenGLRenderer::getShaderPrebuilds()
+{
+    return *mp_shaderPrebuilds;
+}
+
+CompiledGLSLProgramRegistry &OpenGLRenderer::getProgramRegistry()
+{
+    return *mp_programRegistry;
+}
+
+CompiledGLSLPipelineMemo &OpenGLRenderer::getPipelineMemo()
+{
+    return *mp_pipelineMemo;
+}
+
+namespace
+{
+enum class BakeableScalar {
+    Float,
+    Int,
+    Uint,
+};
+
+struct BakeableType
+{
+    const TypeInfo *p_typeInfo;
+    const char *glslName;
+    BakeableScalar scalar;
+    std::size_t numComponents;
+    void (*copyBits)(const Variant &value, std::array<std::uint32_t, 4> &bits);
+};
+
+template <class T> void copyBits(const Variant &value, std::array<std::uint32_t, 4> &bits)
+{
+    static_assert(sizeof(T) <= sizeof(bits));
+    std::memcpy(bits.data(), &value.get<T>(), sizeof(T));
+}
+
+const BakeableType *findBakeableType(const TypeInfo &typeInfo)
+{
+    // clang-format off
+    static const BakeableType bakeableTypes[] = {
+        {&TYPE_INFO<       float>, "float", BakeableScalar::Float, 1, &copyBits<       float>},
+        {&TYPE_INFO<   glm::vec2>, "vec2",  BakeableScalar::Float, 2, &copyBits<   glm::vec2>},
+        {&TYPE_INFO<   glm::vec3>, "vec3",  BakeableScalar::Float, 3, &copyBits<   glm::vec3>},
+        {&TYPE_INFO<   glm::vec4>, "vec4",  BakeableScalar::Float, 4, &copyBits<   glm::vec4>},
+        {&TYPE_INFO<         int>, "int",   BakeableScalar::Int,   1, &copyBits<         int>},
+        {&TYPE_INFO<  glm::ivec2>, "ivec2", BakeableScalar::Int,   2, &copyBits<  glm::ivec2>},
+        {&TYPE_INFO<  glm::ivec3>, "ivec3", BakeableScalar::Int,   3, &copyBits<  glm::ivec3>},
+        {&TYPE_INFO<  glm::ivec4>, "ivec4", BakeableScalar::Int,   4, &copyBits<  glm::ivec4>},
+        {&TYPE_INFO<unsigned int>, "uint",  BakeableScalar::Uint,  1, &copyBits<unsigned int>},
+        {&TYPE_INFO<  glm::uvec2>, "uvec2", BakeableScalar::Uint,  2, &copyBits<  glm::uvec2>},
+        {&TYPE_INFO<  glm::uvec3>, "uvec3", BakeableScalar::Uint,  3, &copyBits<  glm::uvec3>},
+        {&TYPE_INFO<  glm::uvec4>, "uvec4", BakeableScalar::Uint,  4, &copyBits<  glm::uvec4>},
+    };
+    // clang-format on
+
+    for (const BakeableType &type : bakeableTypes) {
+        if (*type.p_typeInfo == typeInfo) {
+            return &type;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @returns the GLSL literal of a scalar component, or nothing if it can't be written as one
+ */
+std::optional<String> getGLSLComponentLiteral(BakeableScalar scalar, std::uint32_t bits)
+{
+    switch (scalar) {
+    case BakeableScalar::Float: {
+        float floatValue;
+        std::memcpy(&floatValue, &bits, sizeof(float));
+        if (!std::isfinite(floatValue)) {
+            return std::nullopt;
+        }
+
+        // shortest form that round-trips, made to parse as a float
+        char buffer[32];
+        auto [p_end, errc] = std::to_chars(std::begin(buffer), std::end(buffer), floatValue);
+        String literal(buffer, p_end);
+        if (literal.find_first_of(".e") == String::npos) {
+            literal += ".0";
+        }
+        return literal;
+    }
+    case BakeableScalar::Int: {
+        // the negated literal of the lowest int would overflow
+        std::int32_t intValue;
+        std::memcpy(&intValue, &bits, sizeof(std::int32_t));
+        if (intValue == std::numeric_limits<std::int32_t>::min()) {
+            return std::nullopt;
+        }
+        return std::to_string(intValue);
+    }
+    case BakeableScalar::Uint:
+        return std::to_string(bits) + "u";
+    }
+    return std::nullopt;
+}
+
+/**
+ * @returns the GLSL literal of a scalar or a vector constructor, or nothing if it can't be baked
+ */
+std::optional<String> getGLSLConstantLiteral(const TypeInfo &typeInfo,
+                                             const std::array<std::uint32_t, 4> &bits)
+{
+    const BakeableType *p_type = findBakeableType(typeInfo);
+    if (!p_type) {
+        return std::nullopt;
+    }
+
+    String literal = p_type->numComponents > 1 ? String(p_type->glslName) + "(" : String();
+    for (std::size_t i = 0; i < p_type->numComponents; ++i) {
+        std::optional<String> component = getGLSLComponentLiteral(p_type->scalar, bits[i]);
+        if (!component.has_value()) {
+            return std::nullopt;
+        }
+        literal += (i > 0 ? ", " : "") + *component;
+    }
+    if (p_type->numComponents > 1) {
+        literal += ")";
+    }
+    return literal;
+}
+} // namespace
+
+std::shared_ptr<const GLProgramSpecialization> OpenGLRenderer::getMaterialSpecialization(
+    const Material &material)
+{
+    if (m_staticMaterialPropertyIds.empty()) {
+        return mp_noSpecialization;
+    }
+
+    auto &matProperties = material.getProperties();
+    auto getValue = [&](StringId nameId) -> std::optional<StaticPropertyValue> {
+        auto it = matProperties.find(nameId);
+        if (it == matProperties.end()) {
+            return std::nullopt;
+        }
+        const BakeableType *p_type = findBakeableType((*it).second.getAssignedTypeInfo());
+        if (!p_type) {
+            return std::nullopt;
+        }
+
+        StaticPropertyValue value{.p_typeInfo = p_type->p_typeInfo, .bits = {}};
+        p_type->copyBits((*it).second, value.bits);
+        return value;
+    };
+
+    std::unique_lock lock(m_specializationMutex);
+
+    // reuse the literals formatted for the material, unless its values changed
+    MaterialSpecialization &matSpecialization = m_materialSpecializations[&material];
+    matSpecialization.lastFrame = m_specializationFrame;
+
+    bool isUpToDate = matSpecialization.p_specialization != nullptr;
+    if (isUpToDate) {
+        std::size_t valueIndex = 0;
+        for (StringId nameId : m_staticMaterialPropertyIds) {
+            if (getValue(nameId) != matSpecialization.values[valueIndex++]) {
+                isUpToDate = false;
+                break;
+            }
+        }
+    }
+
+    if (!isUpToDate) {
+        auto p_specialization = std::make_shared<GLProgramSpecialization>();
+        matSpecialization.values.clear();
+
+        // the literals are what gets baked, so they identify the programs
+        for (StringId nameId : m_staticMaterialPropertyIds) {
+            std::optional<StaticPropertyValue> value = getValue(nameId);
+            matSpecialization.values.push_back(value);
+            if (!value.has_value()) {
+                continue;
+            }
+
+            std::optional<String> literal = getGLSLConstantLiteral(*value->p_typeInfo, value->bits);
+            if (!literal.has_value()) {
+                continue;
+            }
+
+            p_specialization->hash = combinedHashes<3>({{
+                p_specialization->hash,
+                std::hash<StringId>{}(nameId),
+                std::hash<String>{}(*literal),
+            }});
+            p_specialization->constantLiterals.emplace(nameId, std::move(*literal));
+        }
+
+        matSpecialization.p_specialization =
+            p_specialization->constantLiterals.empty() ? mp_noSpecialization
+                                                       : std::move(p_specialization);
+    }
+
+    if (matSpecialization.p_specialization == mp_noSpecialization ||
+        !admitSpecializedVariant(matSpecialization.p_specialization->hash)) {
+        return mp_noSpecialization;
+    }
+    return matSpecialization.p_specialization;
+}
+
+bool OpenGLRenderer::admitSpecializedVariant(std::size_t hash)
+{
+    if (auto it = m_specializationLastFrames.find(hash); it != m_specializationLastFrames.end()) {
+        it->second = m_specializationFrame;
+        return true;
+    }
+
+    if (m_specializationLastFrames.size() >= m_params.maxSpecializedVariants) {
+        // replace the least recently requested variant, unless all are still in use
+        auto lruIt = std::min_element(
+            m_specializationLastFrames.begin(), m_specializationLastFrames.end(),
+            [](const auto &a, const auto &b) { return a.second < b.second; });
+        if (lruIt == m_specializationLastFrames.end() ||
+            lruIt->second + 1 >= m_specializationFrame) {
+            // over budget, so the values stay uniforms
+            return false;
+        }
+        m_specializationLastFrames.erase(lruIt);
+    }
+    m_specializationLastFrames.emplace(hash, m_specializationFrame);
+    return true;
+}
+
+bool OpenGLRenderer::isHeadless() const
+{
+    return m_params.contextMode != GLContextMode::Windowed;
+}
+
 void OpenGLRenderer::registerTypeAuto(const TypeInfo &hostType)
 {
     const PolymorphicTypeMeta *p_meta = &hostType.metaDetail;
@@ -389,6 +1016,10 @@ void OpenGLRenderer::specifyTextureSampler(StringView colorName)
                            std::string(colorName) + ", coord_" + std::string(colorName) + ".xy);\n",
             }),
             ShaderStageFlag::Fragment | ShaderStageFlag::Compute);
+
+        // the methods may have been updated in place, so earlier solves could be outdated
+        mp_pipelineMemo->clear();
+        mp_shaderPrebuilds->clear();
     }
 }
 
@@ -415,7 +1046,8 @@ void OpenGLRenderer::setRawBufferBinding(const RawSharedBuffer &buf, int binding
         throw std::runtime_error("OpenGLRawSharedBuffer is not synchronized");
     }
 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingIndex, glbuf.getGlBufferHandle());
+    GLStateCache::current().bindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingIndex,
+                                           glbuf.getGlBufferHandle());
 }
 
 } // namespace Vitrae
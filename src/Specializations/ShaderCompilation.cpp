@@ -4,23 +4,166 @@
 #include "Vitrae/Collections/MethodCollection.hpp"
 #include "Vitrae/Debugging/PipelineExport.hpp"
 #include "Vitrae/Params/ParamList.hpp"
+#include "VitraePluginOpenGL/Bits/CodeWriter.hpp"
+#include "VitraePluginOpenGL/Bits/ShaderArtifacts.hpp"
 #include "VitraePluginOpenGL/Specializations/Renderer.hpp"
 
 #include "MMeter.h"
 
-#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <variant>
+
+// KHR_parallel_shader_compile isn't part of the core profile loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
 namespace Vitrae
 {
 
-CompiledGLSLShader::SurfaceShaderParams::SurfaceShaderParams(const ParamAliases &aliases,
-                                                             String vertexPositionOutputName,
-                                                             const ParamList &fragmentOutputs,
-                                                             ComponentRoot &root)
+namespace
+{
+// uniforms are global variables given to all shader steps
+const String uniVarPrefix = "uniform_";
+const String bindingVarPrefix = "bind_";
+const String uboBlockPrefix = "ubo_block_";
+const String uboVarPrefix = "ubo_";
+const String ssboBlockPrefix = "buffer_block_";
+const String ssboVarPrefix = "buffer_";
+const String localVarPrefix = "tmp_";
+
+// values baked into the program
+const String constVarPrefix = "const_";
+
+// mesh vertex element data is given to the vertex shader and passed through to other steps
+const String elemVarPrefix = "elem_";
+
+GLbitfield getShaderStageBit(GLenum shaderType)
+{
+    switch (shaderType) {
+    case GL_VERTEX_SHADER:
+        return GL_VERTEX_SHADER_BIT;
+    case GL_TESS_CONTROL_SHADER:
+        return GL_TESS_CONTROL_SHADER_BIT;
+    case GL_TESS_EVALUATION_SHADER:
+        return GL_TESS_EVALUATION_SHADER_BIT;
+    case GL_GEOMETRY_SHADER:
+        return GL_GEOMETRY_SHADER_BIT;
+    case GL_FRAGMENT_SHADER:
+        return GL_FRAGMENT_SHADER_BIT;
+    case GL_COMPUTE_SHADER:
+        return GL_COMPUTE_SHADER_BIT;
+    default:
+        return 0;
+    }
+}
+
+// reused by all programs built on the thread
+GLCodeWriter &getThreadCodeWriter()
+{
+    thread_local GLCodeWriter writer;
+    return writer;
+}
+
+// where a varying lives in the interface between two stages
+struct VaryingSlot
+{
+    GLint location;
+    GLint component;
+    bool flat;
+};
+
+/**
+ * @brief Assigns locations to the varyings, packing scalars and vectors of the same basic type
+ * into shared vec4 locations
+ * @note Integer varyings can't be interpolated, so they get flat locations of their own
+ * @returns the number of locations used
+ */
+GLint packVaryings(const std::vector<std::pair<StringId, const GLTypeSpec *>> &varyings,
+                   std::map<StringId, VaryingSlot> &slots)
+{
+    struct PackedLocation
+    {
+        char basicType;
+        GLint numUsedComponents;
+    };
+    std::vector<PackedLocation> packedLocations;
+    std::vector<std::pair<StringId, const GLTypeSpec *>> packables;
+    GLint nextLocation = 0;
+
+    // 'f', 'i' or 'u' for floats, ints and uints and their vectors, 0 for what can't be packed
+    auto getBasicType = [](const String &typeName) -> char {
+        if (typeName == "float") {
+            return 'f';
+        } else if (typeName == "int") {
+            return 'i';
+        } else if (typeName == "uint") {
+            return 'u';
+        } else if (typeName == "vec2" || typeName == "vec3" || typeName == "vec4") {
+            return 'f';
+        } else if (typeName == "ivec2" || typeName == "ivec3" || typeName == "ivec4") {
+            return 'i';
+        } else if (typeName == "uvec2" || typeName == "uvec3" || typeName == "uvec4") {
+            return 'u';
+        }
+        return 0;
+    };
+    auto getNumComponents = [](const String &typeName) -> GLint {
+        char lastChar = typeName.back();
+        return (lastChar >= '2' && lastChar <= '4') ? lastChar - '0' : 1;
+    };
+
+    // matrices and structs take whole locations
+    for (const auto &[nameId, p_glTypeSpec] : varyings) {
+        if (getBasicType(p_glTypeSpec->valueTypeName) != 0) {
+            packables.push_back({nameId, p_glTypeSpec});
+        } else {
+            slots.emplace(nameId, VaryingSlot{.location = nextLocation, .component = 0,
+                                              .flat = false});
+            nextLocation += std::max<GLint>((GLint)p_glTypeSpec->layout.indexSize, 1);
+        }
+    }
+
+    // first fit, largest first, so vec3s get paired with scalars
+    std::stable_sort(packables.begin(), packables.end(), [&](const auto &a, const auto &b) {
+        return getNumComponents(a.second->valueTypeName) >
+               getNumComponents(b.second->valueTypeName);
+    });
+    for (const auto &[nameId, p_glTypeSpec] : packables) {
+        char basicType = getBasicType(p_glTypeSpec->valueTypeName);
+        GLint numComponents = getNumComponents(p_glTypeSpec->valueTypeName);
+
+        std::size_t packedIndex = 0;
+        while (packedIndex < packedLocations.size() &&
+               (packedLocations[packedIndex].basicType != basicType ||
+                packedLocations[packedIndex].numUsedComponents + numComponents > 4)) {
+            ++packedIndex;
+        }
+        if (packedIndex == packedLocations.size()) {
+            packedLocations.push_back({.basicType = basicType, .numUsedComponents = 0});
+        }
+
+        PackedLocation &packedLocation = packedLocations[packedIndex];
+        slots.emplace(nameId, VaryingSlot{.location = nextLocation + (GLint)packedIndex,
+                                          .component = packedLocation.numUsedComponents,
+                                          .flat = basicType != 'f'});
+        packedLocation.numUsedComponents += numComponents;
+    }
+
+    return nextLocation + (GLint)packedLocations.size();
+}
+} // namespace
+
+CompiledGLSLShader::SurfaceShaderParams::SurfaceShaderParams(
+    const ParamAliases &aliases, String vertexPositionOutputName, const ParamList &fragmentOutputs,
+    ComponentRoot &root, const GLProgramSpecialization &specialization)
     : m_aliases(aliases), m_vertexPositionOutputName(vertexPositionOutputName),
-      m_fragmentOutputs(fragmentOutputs), mp_root(&root),
-      m_hash(combinedHashes<3>({{aliases.hash(), fragmentOutputs.getHash(),
-                                 std::hash<StringId>{}(StringId(vertexPositionOutputName))}}))
+      m_fragmentOutputs(fragmentOutputs), mp_root(&root), m_specialization(specialization),
+      m_hash(combinedHashes<4>({{aliases.hash(), fragmentOutputs.getHash(),
+                                 std::hash<StringId>{}(StringId(vertexPositionOutputName)),
+                                 specialization.hash}}))
 {}
 
 CompiledGLSLShader::ComputeShaderParams::ComputeShaderParams(
@@ -45,67 +188,102 @@ CompiledGLSLShader::ComputeShaderParams::ComputeShaderParams(
       }}))
 {}
 
+namespace
+{
+// picks up the build started by CompiledGLSLShaderPrebuilds, or builds in place
+template <class ShaderParams>
+CompiledGLSLShader::SourceBuild takeOrBuildSources(const ShaderParams &params)
+{
+    OpenGLRenderer &rend =
+        static_cast<OpenGLRenderer &>(params.getRoot().getComponent<Renderer>());
+
+    if (auto prebuild = rend.getShaderPrebuilds().take(CompiledGLSLShaderCacherSeed{params});
+        prebuild.has_value()) {
+        return prebuild->get();
+    }
+    return CompiledGLSLShader::buildSources(params);
+}
+
+template <class ShaderParams> std::shared_ptr<const bool> markSeedLive(const ShaderParams &params)
+{
+    OpenGLRenderer &rend =
+        static_cast<OpenGLRenderer &>(params.getRoot().getComponent<Renderer>());
+
+    return rend.getShaderPrebuilds().markLive(CompiledGLSLShaderCacherSeed{params});
+}
+} // namespace
+
+CompiledGLSLShader::SourceBuild CompiledGLSLShader::buildSources(const SurfaceShaderParams &params)
+{
+    return buildSources(
+        {{
+            CompilationSpec{
+                .aliases = ParamAliases({{
+                                            &params.getAliases(),
+                                        }},
+                                        {
+                                            {"gl_Position", params.getVertexPositionOutputName()},
+                                        }),
+                .outVarPrefix = "vert_",
+                .shaderType = GL_VERTEX_SHADER},
+            CompilationSpec{.aliases = ParamAliases({{
+                                &params.getAliases(),
+                            }}),
+                            .outVarPrefix = "frag_",
+                            .shaderType = GL_FRAGMENT_SHADER},
+        }},
+        params.getRoot(), params.getFragmentOutputs(), params.getSpecialization().constantLiterals);
+}
+
 CompiledGLSLShader::CompiledGLSLShader(const SurfaceShaderParams &params)
-    : CompiledGLSLShader(
-          {{
-              CompilationSpec{
-                  .aliases = ParamAliases({{
-                                              &params.getAliases(),
-                                          }},
-                                          {
-                                              {"gl_Position", params.getVertexPositionOutputName()},
-                                          }),
-                  .outVarPrefix = "vert_",
-                  .shaderType = GL_VERTEX_SHADER},
-              CompilationSpec{.aliases = ParamAliases({{
-                                  &params.getAliases(),
-                              }}),
-                              .outVarPrefix = "frag_",
-                              .shaderType = GL_FRAGMENT_SHADER},
-          }},
-          params.getRoot(), params.getFragmentOutputs())
-{}
+    : CompiledGLSLShader(takeOrBuildSources(params), params.getRoot())
+{
+    mp_seedToken = markSeedLive(params);
+}
+
+CompiledGLSLShader::SourceBuild CompiledGLSLShader::buildSources(const ComputeShaderParams &params)
+{
+    return buildSources(
+        {{
+            CompilationSpec{
+                .aliases = ParamAliases({{
+                    &params.getAliases(),
+                }}),
+                .outVarPrefix = "comp_",
+                .shaderType = GL_COMPUTE_SHADER,
+                .computeSpec =
+                    ComputeCompilationSpec{
+                        .invocationCountX = params.getInvocationCountX(),
+                        .invocationCountY = params.getInvocationCountY(),
+                        .invocationCountZ = params.getInvocationCountZ(),
+                        .groupSize = params.getGroupSize(),
+                        .allowOutOfBoundsCompute = params.getAllowOutOfBoundsCompute(),
+                    },
+            },
+        }},
+        params.getRoot(), params.getDesiredResults());
+}
 
 CompiledGLSLShader::CompiledGLSLShader(const ComputeShaderParams &params)
-    : CompiledGLSLShader(
-          {{
-              CompilationSpec{
-                  .aliases = ParamAliases({{
-                      &params.getAliases(),
-                  }}),
-                  .outVarPrefix = "comp_",
-                  .shaderType = GL_COMPUTE_SHADER,
-                  .computeSpec =
-                      ComputeCompilationSpec{
-                          .invocationCountX = params.getInvocationCountX(),
-                          .invocationCountY = params.getInvocationCountY(),
-                          .invocationCountZ = params.getInvocationCountZ(),
-                          .groupSize = params.getGroupSize(),
-                          .allowOutOfBoundsCompute = params.getAllowOutOfBoundsCompute(),
-                      },
-              },
-          }},
-          params.getRoot(), params.getDesiredResults())
-{}
+    : CompiledGLSLShader(takeOrBuildSources(params), params.getRoot())
+{
+    mp_seedToken = markSeedLive(params);
+}
 
-CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationSpecs,
-                                       ComponentRoot &root, const ParamList &desiredOutputs)
+CompiledGLSLShader::SourceBuild CompiledGLSLShader::buildSources(
+    MovableSpan<CompilationSpec> compilationSpecs, ComponentRoot &root,
+    const ParamList &desiredOutputs, const StableMap<StringId, String> &constantLiterals)
 {
-    MMETER_SCOPE_PROFILER("CompiledGLSLShader");
+    MMETER_SCOPE_PROFILER("GLSL build");
 
     OpenGLRenderer &rend = static_cast<OpenGLRenderer &>(root.getComponent<Renderer>());
+    GLShaderArtifactSink &artifactSink = root.getComponent<GLShaderArtifactSink>();
+    bool useSpirv = rend.usesSpirvPrograms();
+    bool separable = rend.usesSeparablePrograms() && compilationSpecs.size() > 1;
+    GLCodeWriter &writer = getThreadCodeWriter();
+    SourceBuild build;
 
-    // uniforms are global variables given to all shader steps
-    String uniVarPrefix = "uniform_";
-    String bindingVarPrefix = "bind_";
-    String uboBlockPrefix = "ubo_block_";
-    String uboVarPrefix = "ubo_";
-    String ssboBlockPrefix = "buffer_block_";
-    String ssboVarPrefix = "buffer_";
-    String localVarPrefix = "tmp_";
-
-    // mesh vertex element data is given to the vertex shader and passed through to other steps
-    String elemVarPrefix = "elem_";
+    writer.reset();
 
     struct CompilationHelp
     {
@@ -115,8 +293,11 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
         // items converted to OpenGLShaderTask
         Pipeline<ShaderTask> pipeline;
 
-        // id of the compiled shader
-        GLuint shaderId;
+        // generated source code
+        String srcCode;
+        String name;
+        std::vector<GLuint> specializationIds;
+        std::vector<GLuint> specializationValues;
     };
 
     std::vector<CompilationHelp> helpers;
@@ -160,8 +341,8 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
             }
 
             try {
-                p_helper->pipeline =
-                    Pipeline<ShaderTask>(p_method, passedVarSpecs, p_helper->p_compSpec->aliases);
+                p_helper->pipeline = rend.getPipelineMemo().getPipeline(
+                    p_method, passedVarSpecs, p_helper->p_compSpec->aliases);
             }
             catch (const PipelineSetupException &ex) {
                 throw std::runtime_error(String("Shader compilation failed: ") + ex.what());
@@ -235,11 +416,35 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
         }
     }
 
+    // uniforms and varyings get explicit locations, so the interface is known before linking
+    auto getLocationCount = [](const GLTypeSpec &glTypeSpec) -> GLint {
+        return std::max<GLint>((GLint)glTypeSpec.layout.indexSize, 1);
+    };
+    GLint nextUniformLocation = 0;
+    auto allocateUniformLocation = [&](const GLTypeSpec &glTypeSpec) -> GLint {
+        GLint location = nextUniformLocation;
+        nextUniformLocation += getLocationCount(glTypeSpec);
+        return location;
+    };
+
     // prepare previous stage inputs
     StableMap<StringId, LocationSpec> prevStageOutputs;
+    std::map<StringId, VaryingSlot> prevStageVaryingSlots;
     String prevStageOutVarPrefix;
 
+    auto writeVaryingLayout = [](std::stringstream &ss, const VaryingSlot &slot) {
+        ss << "layout(location=" << slot.location;
+        if (slot.component != 0) {
+            ss << ", component=" << slot.component;
+        }
+        ss << ") ";
+        if (slot.flat) {
+            ss << "flat ";
+        }
+    };
+
     // Select uniforms, bindings, UBOs and SSBOs
+    std::set<StringId> constantNameIds;
     {
         MMETER_SCOPE_PROFILER("Selecting program inputs");
 
@@ -268,34 +473,39 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
                         nameId,
                         LocationSpec{.srcSpec = spec,
                                      .location = (int)rend.getVertexBufferLayoutIndex(nameId)});
-                    this->vertexComponentSpecs.insert_back(spec);
+                    build.vertexComponentSpecs.insert_back(spec);
                 } else {
                     // decide how to convert it
                     const GLConversionSpec &convSpec = rend.getTypeConversion(spec.typeInfo);
                     const GLTypeSpec &glTypeSpec = convSpec.glTypeSpec;
 
-                    if (convSpec.setUniform) {
-                        this->uniformSpecs.emplace(nameId, LocationSpec{
-                                                               .srcSpec = spec,
-                                                               .location = -1, // will be set later
-                                                           });
+                    if (convSpec.setUniform &&
+                        constantLiterals.find(nameId) != constantLiterals.end()) {
+                        // baked in, so it never gets uploaded
+                        constantNameIds.insert(nameId);
+                    } else if (convSpec.setUniform) {
+                        build.uniformSpecs.emplace(
+                            nameId, LocationSpec{
+                                        .srcSpec = spec,
+                                        .location = allocateUniformLocation(glTypeSpec),
+                                    });
                     } else if (convSpec.setOpaqueBinding) {
-                        this->opaqueBindingSpecs.emplace(nameId,
-                                                         BindingSpec{
-                                                             .srcSpec = spec,
-                                                             .location = -1,    // will be set later
-                                                             .bindingIndex = 0, // will be set later
-                                                         });
+                        build.opaqueBindingSpecs.emplace(
+                            nameId, BindingSpec{
+                                        .srcSpec = spec,
+                                        .location = allocateUniformLocation(glTypeSpec),
+                                        .bindingIndex = 0, // will be set later
+                                    });
                     } else if (convSpec.setUBOBinding) {
-                        this->uboSpecs.emplace(nameId, BindingSpec{
+                        build.uboSpecs.emplace(nameId, BindingSpec{
                                                            .srcSpec = spec,
-                                                           .location = -1,    // will be set later
+                                                           .location = -1, // blocks use bindings
                                                            .bindingIndex = 0, // will be set later
                                                        });
                     } else if (convSpec.setSSBOBinding) {
-                        this->ssboSpecs.emplace(nameId, BindingSpec{
+                        build.ssboSpecs.emplace(nameId, BindingSpec{
                                                             .srcSpec = spec,
-                                                            .location = -1,    // will be set later
+                                                            .location = -1, // blocks use bindings
                                                             .bindingIndex = 0, // will be set later
                                                         });
                     } else {
@@ -312,6 +522,7 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
         for (auto p_helper : helperOrder) {
 
             // Property storage choosing
+            ParamList stageConstantList;
             ParamList stageUniformList;
             ParamList stageOpaqueBindingList;
             ParamList stageUBOList;
@@ -320,7 +531,7 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
             ParamList stageOutputList;
             ParamList stageLocalList;
             std::map<StringId, String> tobeStageAliases;
-            std::vector<std::pair<String, String>> initialPipethroughList;
+            std::vector<std::pair<StringView, StringView>> initialPipethroughList;
 
             {
                 MMETER_SCOPE_PROFILER("Property storage choosing");
@@ -339,20 +550,24 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
                             // normal input
                             stageInputList.insert_back(spec);
                             tobeStageAliases[spec.name] = prevStageOutVarPrefix + spec.name;
-                        } else if (this->uniformSpecs.find(nameId) != this->uniformSpecs.end()) {
+                        } else if (constantNameIds.find(nameId) != constantNameIds.end()) {
+                            // baked constant
+                            stageConstantList.insert_back(spec);
+                            tobeStageAliases[spec.name] = constVarPrefix + spec.name;
+                        } else if (build.uniformSpecs.find(nameId) != build.uniformSpecs.end()) {
                             // uniform
                             stageUniformList.insert_back(spec);
                             tobeStageAliases[spec.name] = uniVarPrefix + spec.name;
-                        } else if (this->opaqueBindingSpecs.find(nameId) !=
-                                   this->opaqueBindingSpecs.end()) {
+                        } else if (build.opaqueBindingSpecs.find(nameId) !=
+                                   build.opaqueBindingSpecs.end()) {
                             // opaque binding
                             stageOpaqueBindingList.insert_back(spec);
                             tobeStageAliases[spec.name] = bindingVarPrefix + spec.name;
-                        } else if (this->uboSpecs.find(nameId) != this->uboSpecs.end()) {
+                        } else if (build.uboSpecs.find(nameId) != build.uboSpecs.end()) {
                             // UBO
                             stageUBOList.insert_back(spec);
                             tobeStageAliases[spec.name] = uboVarPrefix + spec.name;
-                        } else if (this->ssboSpecs.find(nameId) != this->ssboSpecs.end()) {
+                        } else if (build.ssboSpecs.find(nameId) != build.ssboSpecs.end()) {
                             // SSBO
                             stageSSBOList.insert_back(spec);
                             tobeStageAliases[spec.name] = ssboVarPrefix + spec.name;
@@ -378,12 +593,13 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
                         const GLTypeSpec &glTypeSpec = convSpec.glTypeSpec;
 
                         if (!glTypeSpec.valueTypeName.empty()) {
+                            StringView outVarName =
+                                writer.intern(p_helper->p_compSpec->outVarPrefix, spec.name);
                             initialPipethroughList.push_back({
-                                p_helper->p_compSpec->outVarPrefix + spec.name,
-                                tobeStageAliases.at(spec.name),
+                                outVarName,
+                                writer.intern({}, tobeStageAliases.at(spec.name)),
                             });
-                            tobeStageAliases[spec.name] =
-                                p_helper->p_compSpec->outVarPrefix + spec.name;
+                            tobeStageAliases[spec.name] = String(outVarName);
                             stageOutputList.insert_back(spec);
                         } else {
                             throw std::runtime_error("Shader compilation failed: property " +
@@ -407,8 +623,8 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
 
                         if (!glTypeSpec.valueTypeName.empty()) {
                             initialPipethroughList.push_back({
-                                p_helper->p_compSpec->outVarPrefix + spec.name,
-                                tobeStageAliases.at(spec.name),
+                                writer.intern(p_helper->p_compSpec->outVarPrefix, spec.name),
+                                writer.intern({}, tobeStageAliases.at(spec.name)),
                             });
                             stageOutputList.insert_back(spec);
                         } else {
@@ -503,7 +719,8 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
 
             // === code output ===
 
-            std::stringstream ss;
+            writer.clearCode();
+            std::stringstream &ss = writer.stream();
             ParamAliases stageAliases({{&p_helper->p_compSpec->aliases}},
                                       StableMap<StringId, String>(std::move(tobeStageAliases)));
             ShaderTask::BuildContext context{
@@ -523,9 +740,49 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
                 // compute shader spec
                 auto &computeSpec = helperOrder[0]->p_compSpec->computeSpec.value();
 
-                ss << "layout (local_size_x = " << computeSpec.groupSize.x
-                   << ", local_size_y = " << computeSpec.groupSize.y
-                   << ", local_size_z = " << computeSpec.groupSize.z << ") in;\n"
+                if (useSpirv) {
+                    // the group size and bounds checks get specialized when loading the module,
+                    // so the source is the same for all group sizes
+                    ss << "layout (local_size_x_id = 0, local_size_y_id = 1, local_size_z_id = 2) "
+                          "in;\n"
+                       << "layout (constant_id = 3) const bool vitrae_boundsCheckX = true;\n"
+                       << "layout (constant_id = 4) const bool vitrae_boundsCheckY = true;\n"
+                       << "layout (constant_id = 5) const bool vitrae_boundsCheckZ = true;\n"
+                       << "\n";
+
+                    auto needsBoundsCheck = [&](const ArgumentGetter<std::uint32_t> &count,
+                                                std::uint32_t groupSize) -> GLuint {
+                        if (computeSpec.allowOutOfBoundsCompute) {
+                            return GL_FALSE;
+                        } else if (count.isFixed()) {
+                            return count.getFixedValue() % groupSize != 0;
+                        } else {
+                            return groupSize > 1;
+                        }
+                    };
+                    p_helper->specializationIds = {0, 1, 2, 3, 4, 5};
+                    p_helper->specializationValues = {
+                        computeSpec.groupSize.x,
+                        computeSpec.groupSize.y,
+                        computeSpec.groupSize.z,
+                        needsBoundsCheck(computeSpec.invocationCountX, computeSpec.groupSize.x),
+                        needsBoundsCheck(computeSpec.invocationCountY, computeSpec.groupSize.y),
+                        needsBoundsCheck(computeSpec.invocationCountZ, computeSpec.groupSize.z),
+                    };
+                } else {
+                    ss << "layout (local_size_x = " << computeSpec.groupSize.x
+                       << ", local_size_y = " << computeSpec.groupSize.y
+                       << ", local_size_z = " << computeSpec.groupSize.z << ") in;\n"
+                       << "\n";
+                }
+            }
+
+            // separable stages have to declare the built-in outputs they share
+            if (separable && p_helper->p_compSpec->shaderType == GL_VERTEX_SHADER) {
+                ss << "out gl_PerVertex {\n"
+                   << "    vec4 gl_Position;\n"
+                   << "    float gl_PointSize;\n"
+                   << "};\n"
                    << "\n";
             }
 
@@ -541,11 +798,20 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
 
             // Receiving values
 
+            // baked constants
+            for (auto &spec : stageConstantList.getSpecList()) {
+                const GLTypeSpec &glTypeSpec = rend.getTypeConversion(spec.typeInfo).glTypeSpec;
+
+                ss << "const " << glTypeSpec.valueTypeName << " " << constVarPrefix << spec.name
+                   << " = " << constantLiterals.at(spec.name) << ";\n";
+            }
+
             // uniforms
             for (auto &spec : stageUniformList.getSpecList()) {
                 const GLTypeSpec &glTypeSpec = rend.getTypeConversion(spec.typeInfo).glTypeSpec;
 
-                ss << "uniform " << glTypeSpec.valueTypeName << " " << uniVarPrefix << spec.name
+                ss << "layout(location=" << build.uniformSpecs.at(spec.name).location << ") "
+                   << "uniform " << glTypeSpec.valueTypeName << " " << uniVarPrefix << spec.name
                    << ";\n";
             }
 
@@ -555,7 +821,8 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
             for (auto &spec : stageOpaqueBindingList.getSpecList()) {
                 const GLTypeSpec &glTypeSpec = rend.getTypeConversion(spec.typeInfo).glTypeSpec;
 
-                ss << "layout(binding=" << getBinding(spec.name) << ") " << "uniform "
+                ss << "layout(location=" << build.opaqueBindingSpecs.at(spec.name).location
+                   << ", binding=" << getBinding(spec.name) << ") " << "uniform "
                    << glTypeSpec.opaqueTypeName << " " << bindingVarPrefix << spec.name << ";\n";
             }
 
@@ -634,9 +901,12 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
             for (auto &spec : stageInputList.getSpecList()) {
                 const GLTypeSpec &glTypeSpec = rend.getTypeConversion(spec.typeInfo).glTypeSpec;
 
-                if (p_helper->p_compSpec->shaderType == GL_VERTEX_SHADER) {
-                    const LocationSpec &locationSpec = prevStageOutputs.at(spec.name);
-                    ss << "layout(location=" << locationSpec.location << ") ";
+                // vertex buffer indices, or the slots of the previous stage's outputs
+                if (auto slotIt = prevStageVaryingSlots.find(spec.name);
+                    slotIt != prevStageVaryingSlots.end()) {
+                    writeVaryingLayout(ss, slotIt->second);
+                } else {
+                    ss << "layout(location=" << prevStageOutputs.at(spec.name).location << ") ";
                 }
 
                 if (glTypeSpec.valueTypeName.empty()) {
@@ -651,8 +921,47 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
             ss << "\n";
 
             // Outputs
+            std::map<StringId, VaryingSlot> stageVaryingSlots;
+            if (p_helper->p_compSpec->shaderType != GL_FRAGMENT_SHADER &&
+                p_helper->p_compSpec->shaderType != GL_COMPUTE_SHADER) {
+                MMETER_SCOPE_PROFILER("Varying packing");
+
+                // only what the next stage reads needs to be passed on
+                std::set<StringId> nextStageReads;
+                std::size_t stageIndex = p_helper - helpers.data();
+                if (stageIndex + 1 < helpers.size()) {
+                    const Pipeline<ShaderTask> &nextPipeline = helpers[stageIndex + 1].pipeline;
+                    for (const ParamList *p_specs : {
+                             &nextPipeline.inputSpecs,
+                             &nextPipeline.consumingSpecs,
+                             &nextPipeline.filterSpecs,
+                             &nextPipeline.pipethroughSpecs,
+                         }) {
+                        for (auto nameId : p_specs->getSpecNameIds()) {
+                            nextStageReads.insert(nameId);
+                        }
+                    }
+                }
+
+                std::vector<std::pair<StringId, const GLTypeSpec *>> liveVaryings;
+                for (auto &spec : stageOutputList.getSpecList()) {
+                    if (nextStageReads.find(spec.name) != nextStageReads.end()) {
+                        liveVaryings.push_back(
+                            {spec.name, &rend.getTypeConversion(spec.typeInfo).glTypeSpec});
+                    }
+                }
+
+                GLint numVaryingLocations = packVaryings(liveVaryings, stageVaryingSlots);
+                if (numVaryingLocations > rend.getCapabilities().maxVaryingVectors) {
+                    throw std::runtime_error(
+                        "Shader compilation failed: stage outputs exceed the varying limit");
+                }
+                build.numInterpolators += numVaryingLocations;
+            }
+
             for (auto &spec : stageOutputList.getSpecList()) {
                 const GLTypeSpec &glTypeSpec = rend.getTypeConversion(spec.typeInfo).glTypeSpec;
+                bool isDeclaredOutput = true;
 
                 if (p_helper->p_compSpec->shaderType == GL_FRAGMENT_SHADER) {
 
@@ -667,6 +976,15 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
                     assert(index < desiredOutputs.getSpecNameIds().size());
 
                     ss << "layout(location=" << index << ") ";
+                } else if (p_helper->p_compSpec->shaderType != GL_COMPUTE_SHADER) {
+                    // varyings
+                    if (auto slotIt = stageVaryingSlots.find(spec.name);
+                        slotIt != stageVaryingSlots.end()) {
+                        writeVaryingLayout(ss, slotIt->second);
+                    } else {
+                        // the next stage never reads it, so it's only written to
+                        isDeclaredOutput = false;
+                    }
                 }
 
                 if (glTypeSpec.valueTypeName.empty()) {
@@ -674,8 +992,11 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
                                              " because type has no name");
                 }
 
-                ss << "out " << glTypeSpec.valueTypeName << " "
-                   << p_helper->p_compSpec->outVarPrefix << spec.name << ";\n";
+                if (isDeclaredOutput) {
+                    ss << "out ";
+                }
+                ss << glTypeSpec.valueTypeName << " " << p_helper->p_compSpec->outVarPrefix
+                   << spec.name << ";\n";
             }
 
             ss << "\n";
@@ -709,7 +1030,22 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
             if (p_helper->p_compSpec->shaderType == GL_COMPUTE_SHADER) {
                 auto &computeSpec = helperOrder[0]->p_compSpec->computeSpec.value();
 
-                if (!computeSpec.allowOutOfBoundsCompute) {
+                if (!computeSpec.allowOutOfBoundsCompute && useSpirv) {
+                    auto writeBoundsCheck = [&](const ArgumentGetter<std::uint32_t> &count,
+                                                StringView axis, StringView axisUpper) {
+                        ss << "    if (vitrae_boundsCheck" << axisUpper
+                           << " && gl_GlobalInvocationID." << axis << " >= ";
+                        if (count.isFixed()) {
+                            ss << count.getFixedValue();
+                        } else {
+                            ss << stageAliases.choiceStringFor(count.getSpec().name);
+                        }
+                        ss << ") return;\n";
+                    };
+                    writeBoundsCheck(computeSpec.invocationCountX, "x", "X");
+                    writeBoundsCheck(computeSpec.invocationCountY, "y", "Y");
+                    writeBoundsCheck(computeSpec.invocationCountZ, "z", "Z");
+                } else if (!computeSpec.allowOutOfBoundsCompute) {
                     if (computeSpec.invocationCountX.isFixed()) {
                         if (computeSpec.invocationCountX.getFixedValue() % computeSpec.groupSize.x)
                             ss << "    if (gl_GlobalInvocationID.x >= "
@@ -774,121 +1110,80 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
 
             ss << "}\n // main()";
 
-            // === Compile ===
-
-            // create the shader with the source
-            std::string srcCode = ss.str();
-            const char *c_code = srcCode.c_str();
-            p_helper->shaderId = glCreateShader(p_helper->p_compSpec->shaderType);
-            glShaderSource(p_helper->shaderId, 1, &c_code, NULL);
+            p_helper->srcCode = String(writer.getCode());
+            p_helper->name = p_helper->p_compSpec->outVarPrefix +
+                             getPipelineId(p_helper->pipeline, p_helper->p_compSpec->aliases);
 
             // debug
-            String filePrefix = std::string("shaderdebug/") + p_helper->p_compSpec->outVarPrefix +
-                                getPipelineId(p_helper->pipeline, p_helper->p_compSpec->aliases);
-            std::filesystem::path dotFilename = filePrefix + ".dot";
-            std::filesystem::path glslFilename = filePrefix + ".glsl";
-            {
-                std::ofstream file;
-                file.open(dotFilename);
-                exportPipeline(p_helper->pipeline, p_helper->p_compSpec->aliases, file);
-                file.close();
-
-                root.getInfoStream()
-                    << "Graph stored to: '" << (std::filesystem::current_path() / dotFilename)
-                    << "'" << std::endl;
-            }
-            {
-                std::ofstream file;
-                file.open(glslFilename);
-                file << srcCode;
-                file.close();
-
-                root.getInfoStream()
-                    << "Shader stored to: '" << (std::filesystem::current_path() / glslFilename)
-                    << "'" << std::endl;
-            }
+            if (artifactSink.isEnabled()) {
+                std::stringstream dotStream;
+                exportPipeline(p_helper->pipeline, p_helper->p_compSpec->aliases, dotStream);
 
-            // compile
-            int success;
-            char cmplLog[1024];
-            glCompileShader(p_helper->shaderId);
-
-            glGetShaderInfoLog(p_helper->shaderId, sizeof(cmplLog), nullptr, cmplLog);
-            glGetShaderiv(p_helper->shaderId, GL_COMPILE_STATUS, &success);
-            if (!success) {
-                root.getErrStream() << "Shader compilation error: file: " << glslFilename << "\n"
-                                    << cmplLog << std::endl;
-            } else {
-                root.getInfoStream() << "Shader compiled! " << cmplLog << std::endl;
+                artifactSink.submit({
+                    .name = p_helper->name + ".dot",
+                    .content = dotStream.str(),
+                });
+                artifactSink.submit({
+                    .name = p_helper->name + ".glsl",
+                    .content = p_helper->srcCode,
+                });
             }
 
             // === Prepare for the next stage ===
 
             prevStageOutVarPrefix = p_helper->p_compSpec->outVarPrefix;
             prevStageOutputs.clear();
-            for (const auto &[nameId, spec] : stageOutputList.getMappedSpecs()) {
-                prevStageOutputs.emplace(nameId, LocationSpec{
-                                                     .srcSpec = spec,
-                                                     .location = 0, /// TODO: fixed locations
-                                                 });
+            for (const auto &[nameId, slot] : stageVaryingSlots) {
+                prevStageOutputs.emplace(
+                    nameId, LocationSpec{
+                                .srcSpec = stageOutputList.getMappedSpecs().at(nameId),
+                                .location = slot.location,
+                            });
             }
+            prevStageVaryingSlots = std::move(stageVaryingSlots);
         }
     }
 
-    // Link shaders
-    {
-        int success;
-        char cmplLog[1024];
-
-        programGLName = glCreateProgram();
-        for (auto p_helper : helperOrder) {
-            glAttachShader(programGLName, p_helper->shaderId);
-        }
-        glLinkProgram(programGLName);
-
-        glGetProgramInfoLog(programGLName, sizeof(cmplLog), nullptr, cmplLog);
-        glGetProgramiv(programGLName, GL_LINK_STATUS, &success);
-        if (!success) {
-            root.getErrStream() << "Shader linking error: " << cmplLog << std::endl;
-        } else {
-            root.getInfoStream() << "Shader linked! " << cmplLog << std::endl;
-        }
-
-        for (auto p_helper : helperOrder) {
-            glDeleteShader(p_helper->shaderId);
+    // assign the binding indices; the maps get rebuilt, since iterating them yields copies
+    auto assignBindingIndices = [&](StableMap<StringId, BindingSpec> &specs) {
+        StableMap<StringId, BindingSpec> assignedSpecs;
+        for (auto [nameId, spec] : specs) {
+            spec.bindingIndex = getBinding(nameId);
+            assignedSpecs.emplace(nameId, spec);
         }
+        specs = std::move(assignedSpecs);
+    };
+    assignBindingIndices(build.opaqueBindingSpecs);
+    assignBindingIndices(build.uboSpecs);
+    assignBindingIndices(build.ssboSpecs);
+
+    // check the bindings against the implementation limits
+    const GLCapabilities &caps = rend.getCapabilities();
+    if (nextUniformLocation > caps.maxUniformLocations) {
+        throw std::runtime_error("Shader compilation failed: uniforms exceed the location limit");
     }
-
-    // delete shaders (they will continue to exist while attached to program)
-    for (auto p_helper : helperOrder) {
-        glDeleteShader(p_helper->shaderId);
-    }
-
-    // store uniform indices
-    for (auto nameIdSpecPair : this->uniformSpecs) {
-        nameIdSpecPair.second.location = glGetUniformLocation(
-            programGLName, (uniVarPrefix + nameIdSpecPair.second.srcSpec.name).c_str());
-    }
-    for (auto nameIdSpecPair : this->opaqueBindingSpecs) {
-        nameIdSpecPair.second.location = glGetUniformLocation(
-            programGLName, (bindingVarPrefix + nameIdSpecPair.second.srcSpec.name).c_str());
-        nameIdSpecPair.second.bindingIndex = namedBindings.at(nameIdSpecPair.first);
+    for (auto [nameId, bindSpec] : build.opaqueBindingSpecs) {
+        if (bindSpec.bindingIndex >= (GLuint)caps.maxCombinedTextureImageUnits) {
+            throw std::runtime_error("Shader compilation failed: binding of " +
+                                     bindSpec.srcSpec.name + " exceeds the texture unit limit");
+        }
     }
-    for (auto nameIdSpecPair : this->uboSpecs) {
-        nameIdSpecPair.second.location = glGetUniformBlockIndex(
-            programGLName, (uboVarPrefix + nameIdSpecPair.second.srcSpec.name).c_str());
-        nameIdSpecPair.second.bindingIndex = namedBindings.at(nameIdSpecPair.first);
+    for (auto [nameId, uboSpec] : build.uboSpecs) {
+        if (uboSpec.bindingIndex >= (GLuint)caps.maxUniformBufferBindings) {
+            throw std::runtime_error("Shader compilation failed: binding of " +
+                                     uboSpec.srcSpec.name + " exceeds the UBO binding limit");
+        }
     }
-    for (auto nameIdSpecPair : this->ssboSpecs) {
-        nameIdSpecPair.second.location = glGetProgramResourceIndex(
-            programGLName, GL_SHADER_STORAGE_BLOCK,
-            (ssboBlockPrefix + nameIdSpecPair.second.srcSpec.name).c_str());
-        nameIdSpecPair.second.bindingIndex = namedBindings.at(nameIdSpecPair.first);
+    for (auto [nameId, ssboSpec] : build.ssboSpecs) {
+        if (ssboSpec.bindingIndex >= (GLuint)caps.maxShaderStorageBufferBindings) {
+            throw std::runtime_error("Shader compilation failed: binding of " +
+                                     ssboSpec.srcSpec.name + " exceeds the SSBO binding limit");
+        }
     }
 
     // combine the property specs
     for (auto nameIdSpecPair : desiredOutputs.getMappedSpecs()) {
-        this->outputSpecs.insert_back(nameIdSpecPair.second);
+        build.outputSpecs.insert_back(nameIdSpecPair.second);
     }
     for (auto p_specs : {
              &helperOrder[0]->pipeline.inputSpecs,
@@ -897,10 +1192,10 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
              &helperOrder[0]->pipeline.pipethroughSpecs,
          }) {
         for (auto [nameId, spec] : p_specs->getMappedSpecs()) {
-            if (this->uniformSpecs.find(nameId) != this->uniformSpecs.end() ||
-                this->opaqueBindingSpecs.find(nameId) != this->opaqueBindingSpecs.end() ||
-                this->uboSpecs.find(nameId) != this->uboSpecs.end() ||
-                this->ssboSpecs.find(nameId) != this->ssboSpecs.end() ||
+            if (build.uniformSpecs.find(nameId) != build.uniformSpecs.end() ||
+                build.opaqueBindingSpecs.find(nameId) != build.opaqueBindingSpecs.end() ||
+                build.uboSpecs.find(nameId) != build.uboSpecs.end() ||
+                build.ssboSpecs.find(nameId) != build.ssboSpecs.end() ||
                 spec.typeInfo == TYPE_INFO<void>) {
                 // the property is used
                 bool wasConsumed = false;
@@ -917,109 +1212,605 @@ CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationS
                 }
 
                 if (wasConsumed) {
-                    this->consumingSpecs.insert_back(spec);
+                    build.consumingSpecs.insert_back(spec);
                 } else if (wasModified) {
-                    this->filterSpecs.insert_back(spec);
+                    build.filterSpecs.insert_back(spec);
                 } else {
-                    this->inputSpecs.insert_back(spec);
+                    build.inputSpecs.insert_back(spec);
                 }
             }
         }
     }
+
+    for (auto p_helper : helperOrder) {
+        std::shared_ptr<const GLSpirvModule> p_spirvModule;
+        if (useSpirv) {
+            MMETER_SCOPE_PROFILER("SPIR-V compilation");
+
+            try {
+                p_spirvModule = rend.getSpirvModuleCache().getModule(
+                    p_helper->p_compSpec->shaderType, p_helper->srcCode);
+            }
+            catch (const std::runtime_error &ex) {
+                root.getErrStream() << "Shader " << p_helper->name << " " << ex.what()
+                                    << std::endl;
+                throw std::runtime_error("Shader compilation failed: " + p_helper->name +
+                                         " doesn't compile to SPIR-V");
+            }
+        }
+
+        build.stages.push_back(SourceBuild::Stage{
+            .shaderType = p_helper->p_compSpec->shaderType,
+            .srcCode = std::move(p_helper->srcCode),
+            .name = p_helper->name,
+            .p_spirvModule = std::move(p_spirvModule),
+            .specializationIds = std::move(p_helper->specializationIds),
+            .specializationValues = std::move(p_helper->specializationValues),
+        });
+    }
+
+    return build;
+}
+
+CompiledGLSLShader::CompiledGLSLShader(MovableSpan<CompilationSpec> compilationSpecs,
+                                       ComponentRoot &root, const ParamList &desiredOutputs)
+    : CompiledGLSLShader(buildSources(std::move(compilationSpecs), root, desiredOutputs), root)
+{}
+
+CompiledGLSLShader::CompiledGLSLShader(SourceBuild &&build, ComponentRoot &root)
+    : inputSpecs(std::move(build.inputSpecs)), outputSpecs(std::move(build.outputSpecs)),
+      filterSpecs(std::move(build.filterSpecs)), consumingSpecs(std::move(build.consumingSpecs)),
+      programGLName(0), programPipelineGLName(0),
+      vertexComponentSpecs(std::move(build.vertexComponentSpecs)),
+      uniformSpecs(std::move(build.uniformSpecs)),
+      opaqueBindingSpecs(std::move(build.opaqueBindingSpecs)),
+      uboSpecs(std::move(build.uboSpecs)), ssboSpecs(std::move(build.ssboSpecs)),
+      programBinarySize(0), numInterpolators(build.numInterpolators), m_interfacePending(true)
+{
+    MMETER_SCOPE_PROFILER("CompiledGLSLShader");
+
+    OpenGLRenderer &rend = static_cast<OpenGLRenderer &>(root.getComponent<Renderer>());
+
+    if (rend.getParams().diagnosticLevel == GLDiagnosticLevel::Verbose && !build.stages.empty()) {
+        root.getInfoStream() << "Program " << build.stages.back().name << " uses "
+                             << numInterpolators << " interpolators" << std::endl;
+    }
+
+    // separable stages get compiled and shared on their own, and combined once linked
+    if (rend.usesSeparablePrograms() && build.stages.size() > 1) {
+        for (auto &stage : build.stages) {
+            std::vector<SourceBuild::Stage> stages;
+            stages.push_back(std::move(stage));
+            m_programs.push_back(obtainProgram(std::move(stages), true, rend, root));
+        }
+    } else {
+        m_programs.push_back(obtainProgram(std::move(build.stages), false, rend, root));
+        programGLName = m_programs[0]->programGLName;
+    }
+
+    if (rend.getParams().pendingProgramPolicy == GLPendingProgramPolicy::Wait) {
+        waitUntilReady();
+    }
 }
 
 CompiledGLSLShader::~CompiledGLSLShader()
 {
-    glDeleteProgram(programGLName);
+    if (programPipelineGLName != 0) {
+        if (GLStateCache *p_stateCache = GLStateCache::tryCurrent()) {
+            p_stateCache->forgetProgramPipeline(programPipelineGLName);
+        }
+        glDeleteProgramPipelines(1, &programPipelineGLName);
+    }
 }
 
-void CompiledGLSLShader::setupProperties(OpenGLRenderer &rend, VariantScope &env) const
+std::shared_ptr<CompiledGLSLShader::LinkedProgram> CompiledGLSLShader::obtainProgram(
+    std::vector<SourceBuild::Stage> &&stages, bool separable, OpenGLRenderer &rend,
+    ComponentRoot &root)
 {
-    MMETER_SCOPE_PROFILER(
-        "CompiledGLSLShader::setupProperties(OpenGLRenderer &rend, VariantScope &env) const");
+    const GLCapabilities &caps = rend.getCapabilities();
+    const GLProgramBinaryCache &binaryCache = rend.getProgramBinaryCache();
+    GLPendingProgramPolicy pendingPolicy = rend.getParams().pendingProgramPolicy;
+
+    // identify the program by its sources
+    std::vector<String> stageSources;
+    if (separable) {
+        // a separable program links differently than a whole one with the same source
+        stageSources.push_back("separable");
+    }
+    for (auto &stage : stages) {
+        stageSources.push_back(stage.srcCode);
 
-    for (auto [propertyNameId, uniSpec] : this->uniformSpecs) {
-        if (env.has(propertyNameId)) {
-            rend.getTypeConversion(uniSpec.srcSpec.typeInfo)
-                .setUniform(uniSpec.location, env.get(propertyNameId));
+        // specialized SPIR-V stages share the source, but not the binary
+        if (stage.p_spirvModule) {
+            std::stringstream ss;
+            ss << "spirv";
+            for (std::size_t i = 0; i < stage.specializationIds.size(); ++i) {
+                ss << " " << stage.specializationIds[i] << "=" << stage.specializationValues[i];
+            }
+            stageSources.push_back(ss.str());
         }
     }
+    String sources;
+    for (const String &stageSource : stageSources) {
+        // separate the stages, so moving code between them changes the sources
+        sources += stageSource;
+        sources += '\0';
+    }
+
+    auto p_program = std::make_shared<LinkedProgram>();
+    p_program->p_root = &root;
+    p_program->p_renderer = &rend;
+    p_program->separable = separable;
+    for (auto &stage : stages) {
+        p_program->stageBits |= getShaderStageBit(stage.shaderType);
+    }
+    p_program->binaryKey = binaryCache.computeKey(stageSources);
+    p_program->p_pendingLink = std::make_unique<PendingLink>(PendingLink{
+        .stages = std::move(stages),
+    });
+
+    // share the program of another shader with the same sources; one step, so racing threads
+    // don't both link it
+    if (auto p_existing = rend.getProgramRegistry().findOrInsert(sources, p_program);
+        p_existing != p_program) {
+        return p_existing;
+    }
+
+    LinkedProgram &program = *p_program;
+    PendingLink &pending = *program.p_pendingLink;
 
-    for (auto [propertyNameId, bindSpec] : this->opaqueBindingSpecs) {
-        if (env.has(propertyNameId)) {
-            rend.getTypeConversion(bindSpec.srcSpec.typeInfo)
-                .setOpaqueBinding(bindSpec.bindingIndex, env.get(propertyNameId));
+    // === Compile and link ===
+
+    // Try the program binary cache
+    if (binaryCache.isEnabled()) {
+        MMETER_SCOPE_PROFILER("Program binary cache lookup");
+
+        pending.cachedBinary = binaryCache.load(program.binaryKey);
+
+        if (pending.cachedBinary.has_value()) {
+            int success;
+
+            program.programGLName = glCreateProgram();
+            if (separable) {
+                glProgramParameteri(program.programGLName, GL_PROGRAM_SEPARABLE, GL_TRUE);
+            }
+            glProgramBinary(program.programGLName, pending.cachedBinary->binaryFormat,
+                            pending.cachedBinary->binary.data(),
+                            pending.cachedBinary->binary.size());
+            glGetProgramiv(program.programGLName, GL_LINK_STATUS, &success);
+            if (success) {
+                pending.linkedFromCache = true;
+            } else {
+                // the driver rejected it; compile from source instead
+                glDeleteProgram(program.programGLName);
+                pending.cachedBinary.reset();
+            }
         }
     }
 
-    for (auto [propertyNameId, uboSpec] : this->uboSpecs) {
-        if (env.has(propertyNameId)) {
-            rend.getTypeConversion(uboSpec.srcSpec.typeInfo)
-                .setUBOBinding(uboSpec.bindingIndex, env.get(propertyNameId));
+    if (!pending.linkedFromCache) {
+        program.programGLName = glCreateProgram();
+
+        if (pendingPolicy != GLPendingProgramPolicy::Wait && caps.hasParallelShaderCompile) {
+            // the driver compiles on its own threads; we poll for completion
+            program.submitCompileAndLink();
+            pending.pollCompletionStatus = true;
+        } else if (pendingPolicy != GLPendingProgramPolicy::Wait &&
+                   rend.getNumWorkerContexts() > 0) {
+            // compile on a worker context; the program object is shared with it
+            program.workerLink = rend.runOnWorkerContext([&program]() {
+                program.submitCompileAndLink();
+                // make the results visible to the other contexts
+                glFinish();
+            });
+        } else {
+            program.submitCompileAndLink();
         }
     }
 
-    for (auto [propertyNameId, ssboSpec] : this->ssboSpecs) {
-        if (env.has(propertyNameId)) {
-            rend.getTypeConversion(ssboSpec.srcSpec.typeInfo)
-                .setSSBOBinding(ssboSpec.bindingIndex, env.get(propertyNameId));
+    return p_program;
+}
+
+bool CompiledGLSLShader::isReady()
+{
+    if (!m_interfacePending) {
+        return true;
+    }
+
+    // poll all of them, so every stage gets finished as soon as possible
+    bool allLinked = true;
+    for (auto &p_program : m_programs) {
+        allLinked = p_program->pollLink() && allLinked;
+    }
+    if (!allLinked) {
+        return false;
+    }
+
+    resolveInterface();
+    return true;
+}
+
+void CompiledGLSLShader::waitUntilReady()
+{
+    if (!m_interfacePending) {
+        return;
+    }
+
+    for (auto &p_program : m_programs) {
+        p_program->waitForLink();
+    }
+    resolveInterface();
+}
+
+void CompiledGLSLShader::use() const
+{
+    GLStateCache &stateCache = GLStateCache::current();
+    if (programPipelineGLName != 0) {
+        // a current program would take precedence over the pipeline
+        stateCache.useProgram(0);
+        stateCache.bindProgramPipeline(programPipelineGLName);
+    } else {
+        stateCache.useProgram(programGLName);
+    }
+}
+
+std::span<const CompiledGLSLShader::UniformTarget> CompiledGLSLShader::getUniformTargets(
+    StringId nameId) const
+{
+    if (auto it = m_uniformTargets.find(nameId); it != m_uniformTargets.end()) {
+        return (*it).second;
+    }
+    return {};
+}
+
+void CompiledGLSLShader::resolveInterface()
+{
+    MMETER_FUNC_PROFILER;
+
+    m_interfacePending = false;
+
+    ComponentRoot &root = *m_programs[0]->p_root;
+    OpenGLRenderer &rend = *m_programs[0]->p_renderer;
+
+    // combine the stage programs
+    if (m_programs[0]->separable) {
+        glCreateProgramPipelines(1, &programPipelineGLName);
+        for (auto &p_program : m_programs) {
+            glUseProgramStages(programPipelineGLName, p_program->stageBits,
+                               p_program->programGLName);
         }
     }
+
+    // an input is active if any of the programs uses it
+    GLActiveProgramInterface activeInterface;
+    for (auto &p_program : m_programs) {
+        auto append = [](std::vector<GLint> &to, const std::vector<GLint> &from) {
+            to.insert(to.end(), from.begin(), from.end());
+        };
+        append(activeInterface.uniformLocations, p_program->activeInterface.uniformLocations);
+        append(activeInterface.uniformBlockBindings,
+               p_program->activeInterface.uniformBlockBindings);
+        append(activeInterface.storageBlockBindings,
+               p_program->activeInterface.storageBlockBindings);
+        programBinarySize += p_program->programBinarySize;
+    }
+
+    // drop the inputs the linker optimized out; the rest already have their explicit locations
+    auto keepActive = [&]<class Spec>(StableMap<StringId, Spec> &specs,
+                                      const std::vector<GLint> &activeIndices,
+                                      auto getIndex) {
+        StableMap<StringId, Spec> activeSpecs;
+        for (auto [nameId, spec] : specs) {
+            if (std::find(activeIndices.begin(), activeIndices.end(), getIndex(spec)) !=
+                activeIndices.end()) {
+                activeSpecs.emplace(nameId, spec);
+            }
+        }
+        specs = std::move(activeSpecs);
+    };
+    auto getLocation = [](const auto &spec) { return (GLint)spec.location; };
+    auto getBindingIndex = [](const BindingSpec &spec) { return (GLint)spec.bindingIndex; };
+    keepActive(this->uniformSpecs, activeInterface.uniformLocations, getLocation);
+    keepActive(this->opaqueBindingSpecs, activeInterface.uniformLocations, getLocation);
+    keepActive(this->uboSpecs, activeInterface.uniformBlockBindings, getBindingIndex);
+    keepActive(this->ssboSpecs, activeInterface.storageBlockBindings, getBindingIndex);
+
+    // cross-check against the per-name queries when debugging;
+    // SPIR-V programs aren't required to keep their names
+    if (rend.getParams().diagnosticLevel == GLDiagnosticLevel::Verbose &&
+        !rend.usesSpirvPrograms()) {
+        for (auto &p_program : m_programs) {
+            if (!p_program->linkSucceeded) {
+                continue;
+            }
+
+            const auto &programLocations = p_program->activeInterface.uniformLocations;
+            auto verifyLocation = [&](const String &glslName, GLint location) {
+                if (std::find(programLocations.begin(), programLocations.end(), location) ==
+                    programLocations.end()) {
+                    return;
+                }
+                GLint queried = glGetUniformLocation(p_program->programGLName, glslName.c_str());
+                if (queried != location) {
+                    root.getErrStream() << "Shader reflection mismatch: " << glslName << " at "
+                                        << location << ", queried " << queried << std::endl;
+                }
+            };
+            for (auto [nameId, uniSpec] : this->uniformSpecs) {
+                verifyLocation(uniVarPrefix + uniSpec.srcSpec.name, uniSpec.location);
+            }
+            for (auto [nameId, bindSpec] : this->opaqueBindingSpecs) {
+                verifyLocation(bindingVarPrefix + bindSpec.srcSpec.name, bindSpec.location);
+            }
+        }
+    }
+
+    // find which programs receive each uniform
+    for (auto [nameId, uniSpec] : this->uniformSpecs) {
+        std::vector<UniformTarget> targets;
+        for (auto &p_program : m_programs) {
+            const auto &programLocations = p_program->activeInterface.uniformLocations;
+            if (std::find(programLocations.begin(), programLocations.end(), uniSpec.location) !=
+                programLocations.end()) {
+                targets.push_back({p_program->programGLName, uniSpec.location});
+            }
+        }
+        m_uniformTargets.emplace(nameId, std::move(targets));
+    }
+
+    // flatten into the binding plan, so per-draw setup doesn't have to look up conversions
+    this->bindingPlan.reserve(this->uniformSpecs.size() + this->opaqueBindingSpecs.size() +
+                              this->uboSpecs.size() + this->ssboSpecs.size());
+    for (auto [nameId, uniSpec] : this->uniformSpecs) {
+        auto setUniform = rend.getTypeConversion(uniSpec.srcSpec.typeInfo).setUniform;
+        if (programPipelineGLName != 0) {
+            // once per stage, as each separable program has its own uniform values
+            for (const UniformTarget &target : getUniformTargets(nameId)) {
+                this->bindingPlan.push_back(BindingPlanEntry{
+                    .nameId = nameId,
+                    .locationOrBinding = uniSpec.location,
+                    .setUniform = setUniform,
+                    .p_setBinding = nullptr,
+                    .programPipelineGLName = programPipelineGLName,
+                    .stageProgramGLName = target.programGLName,
+                });
+            }
+        } else {
+            this->bindingPlan.push_back(BindingPlanEntry{
+                .nameId = nameId,
+                .locationOrBinding = uniSpec.location,
+                .setUniform = setUniform,
+                .p_setBinding = nullptr,
+            });
+        }
+    }
+    for (auto [nameId, bindSpec] : this->opaqueBindingSpecs) {
+        this->bindingPlan.push_back(BindingPlanEntry{
+            .nameId = nameId,
+            .locationOrBinding = (GLint)bindSpec.bindingIndex,
+            .setUniform = nullptr,
+            .p_setBinding = &rend.getTypeConversion(bindSpec.srcSpec.typeInfo).setOpaqueBinding,
+        });
+    }
+    for (auto [nameId, uboSpec] : this->uboSpecs) {
+        this->bindingPlan.push_back(BindingPlanEntry{
+            .nameId = nameId,
+            .locationOrBinding = (GLint)uboSpec.bindingIndex,
+            .setUniform = nullptr,
+            .p_setBinding = &rend.getTypeConversion(uboSpec.srcSpec.typeInfo).setUBOBinding,
+        });
+    }
+    for (auto [nameId, ssboSpec] : this->ssboSpecs) {
+        this->bindingPlan.push_back(BindingPlanEntry{
+            .nameId = nameId,
+            .locationOrBinding = (GLint)ssboSpec.bindingIndex,
+            .setUniform = nullptr,
+            .p_setBinding = &rend.getTypeConversion(ssboSpec.srcSpec.typeInfo).setSSBOBinding,
+        });
+    }
 }
 
-void CompiledGLSLShader::setupProperties(OpenGLRenderer &rend, VariantScope &envProperties,
-                                         const Material &material) const
+/*
+Linked program
+*/
+
+CompiledGLSLShader::LinkedProgram::~LinkedProgram()
 {
-    MMETER_SCOPE_PROFILER("CompiledGLSLShader::setupProperties(OpenGLRenderer &rend, VariantScope "
-                          "&envProperties, const Material &material) const");
+    if (workerLink.valid()) {
+        workerLink.wait();
+    }
+    if (p_pendingLink) {
+        for (GLuint shaderId : p_pendingLink->shaderIds) {
+            glDeleteShader(shaderId);
+        }
+    }
 
-    auto &matProperties = material.getProperties();
+    // a candidate that lost to an already registered program never got a GL program
+    if (programGLName != 0) {
+        if (GLStateCache *p_stateCache = GLStateCache::tryCurrent()) {
+            p_stateCache->forgetProgram(programGLName);
+        }
+        glDeleteProgram(programGLName);
+    }
+    p_renderer->getMemoryLedger().remove(GLMemoryCategory::Programs, programBinarySize);
+}
 
-    for (auto [propertyNameId, uniSpec] : this->uniformSpecs) {
-        if (auto nameValIt = matProperties.find(propertyNameId); nameValIt != matProperties.end()) {
-            // convert material variant to uniform
-            rend.getTypeConversion(uniSpec.srcSpec.typeInfo)
-                .setUniform(uniSpec.location, (*nameValIt).second);
-        } else if (envProperties.has(propertyNameId)) {
-            // convert context variant to uniform
-            rend.getTypeConversion(uniSpec.srcSpec.typeInfo)
-                .setUniform(uniSpec.location, envProperties.get(propertyNameId));
+void CompiledGLSLShader::LinkedProgram::submitCompileAndLink()
+{
+    for (auto &stage : p_pendingLink->stages) {
+        GLuint shaderId = glCreateShader(stage.shaderType);
+        if (stage.p_spirvModule) {
+            glShaderBinary(1, &shaderId, GL_SHADER_BINARY_FORMAT_SPIR_V,
+                           stage.p_spirvModule->data(),
+                           (GLsizei)(stage.p_spirvModule->size() * sizeof(std::uint32_t)));
+            glSpecializeShader(shaderId, "main", (GLuint)stage.specializationIds.size(),
+                               stage.specializationIds.data(),
+                               stage.specializationValues.data());
+        } else {
+            const char *c_code = stage.srcCode.c_str();
+            glShaderSource(shaderId, 1, &c_code, NULL);
+            glCompileShader(shaderId);
         }
+        p_pendingLink->shaderIds.push_back(shaderId);
+    }
+
+    if (separable) {
+        glProgramParameteri(programGLName, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    }
+    if (p_renderer->getProgramBinaryCache().isEnabled()) {
+        glProgramParameteri(programGLName, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     }
+    for (GLuint shaderId : p_pendingLink->shaderIds) {
+        glAttachShader(programGLName, shaderId);
+    }
+    glLinkProgram(programGLName);
+}
 
-    for (auto [propertyNameId, bindSpec] : this->opaqueBindingSpecs) {
-        if (auto nameValIt = matProperties.find(propertyNameId); nameValIt != matProperties.end()) {
-            // bind material variant value
-            rend.getTypeConversion(bindSpec.srcSpec.typeInfo)
-                .setOpaqueBinding(bindSpec.bindingIndex, (*nameValIt).second);
-        } else if (envProperties.has(propertyNameId)) {
-            // bind context variant value
-            rend.getTypeConversion(bindSpec.srcSpec.typeInfo)
-                .setOpaqueBinding(bindSpec.bindingIndex, envProperties.get(propertyNameId));
+bool CompiledGLSLShader::LinkedProgram::pollLink()
+{
+    if (!p_pendingLink) {
+        return true;
+    }
+
+    if (workerLink.valid()) {
+        if (workerLink.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+        workerLink.get();
+    } else if (p_pendingLink->pollCompletionStatus) {
+        GLint completed = GL_FALSE;
+        glGetProgramiv(programGLName, GL_COMPLETION_STATUS_KHR, &completed);
+        if (!completed) {
+            return false;
         }
     }
 
-    for (auto [propertyNameId, uboSpec] : this->uboSpecs) {
-        if (auto nameValIt = matProperties.find(propertyNameId); nameValIt != matProperties.end()) {
-            // bind material variant UBO
-            rend.getTypeConversion(uboSpec.srcSpec.typeInfo)
-                .setUBOBinding(uboSpec.bindingIndex, (*nameValIt).second);
-        } else if (envProperties.has(propertyNameId)) {
-            // bind context variant UBO
-            rend.getTypeConversion(uboSpec.srcSpec.typeInfo)
-                .setUBOBinding(uboSpec.bindingIndex, envProperties.get(propertyNameId));
+    finishLink();
+    return true;
+}
+
+void CompiledGLSLShader::LinkedProgram::waitForLink()
+{
+    if (!p_pendingLink) {
+        return;
+    }
+
+    MMETER_FUNC_PROFILER;
+
+    if (workerLink.valid()) {
+        workerLink.get();
+    }
+    // the status queries block until the driver is done
+    finishLink();
+}
+
+void CompiledGLSLShader::LinkedProgram::finishLink()
+{
+    MMETER_FUNC_PROFILER;
+
+    std::unique_ptr<PendingLink> p_pending = std::move(p_pendingLink);
+    ComponentRoot &root = *p_root;
+    linkSucceeded = p_pending->linkedFromCache;
+
+    if (!p_pending->linkedFromCache) {
+        int success;
+        char cmplLog[1024];
+
+        for (std::size_t i = 0; i < p_pending->shaderIds.size(); ++i) {
+            const SourceBuild::Stage &stage = p_pending->stages[i];
+            glGetShaderInfoLog(p_pending->shaderIds[i], sizeof(cmplLog), nullptr, cmplLog);
+            glGetShaderiv(p_pending->shaderIds[i], GL_COMPILE_STATUS, &success);
+            if (!success) {
+                root.getErrStream() << "Shader compilation error: stage: " << stage.name << "\n"
+                                    << cmplLog << std::endl;
+            } else if (cmplLog[0] != '\0') {
+                root.getWarningStream()
+                    << "Shader compilation log: stage: " << stage.name << "\n"
+                    << cmplLog << std::endl;
+            }
+        }
+
+        glGetProgramInfoLog(programGLName, sizeof(cmplLog), nullptr, cmplLog);
+        glGetProgramiv(programGLName, GL_LINK_STATUS, &success);
+        if (!success) {
+            root.getErrStream() << "Shader linking error: " << cmplLog << std::endl;
+        } else {
+            if (cmplLog[0] != '\0') {
+                root.getWarningStream() << "Shader linking log: " << cmplLog << std::endl;
+            }
+            linkSucceeded = true;
+        }
+
+        // delete shaders (they will continue to exist while attached to program)
+        for (GLuint shaderId : p_pending->shaderIds) {
+            glDeleteShader(shaderId);
+        }
+    }
+
+    if (linkSucceeded) {
+        GLint binaryLength = 0;
+        glGetProgramiv(programGLName, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+        programBinarySize = binaryLength;
+        p_renderer->getMemoryLedger().add(GLMemoryCategory::Programs, programBinarySize);
+    }
+
+    // find which inputs are active, or reuse the result stored with the binary
+    if (p_pending->cachedBinary.has_value()) {
+        activeInterface = std::move(p_pending->cachedBinary->activeInterface);
+    } else if (linkSucceeded) {
+        MMETER_SCOPE_PROFILER("Program interface reflection");
+
+        activeInterface = GLActiveProgramInterface::query(programGLName);
+    }
+
+    // store the freshly linked program for the next run
+    const GLProgramBinaryCache &binaryCache = p_renderer->getProgramBinaryCache();
+    if (binaryCache.isEnabled() && linkSucceeded && !p_pending->linkedFromCache) {
+        MMETER_SCOPE_PROFILER("Program binary cache store");
+
+        GLProgramBinaryCache::Entry entry;
+        GLint binaryLength = 0;
+        glGetProgramiv(programGLName, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+        entry.binary.resize(binaryLength);
+
+        GLsizei writtenLength = 0;
+        glGetProgramBinary(programGLName, binaryLength, &writtenLength, &entry.binaryFormat,
+                           entry.binary.data());
+        if (writtenLength > 0) {
+            entry.binary.resize(writtenLength);
+            entry.activeInterface = activeInterface;
+            binaryCache.store(binaryKey, entry);
+        }
+    }
+}
+
+void CompiledGLSLShader::setupProperties(OpenGLRenderer &rend, VariantScope &env) const
+{
+    MMETER_SCOPE_PROFILER(
+        "CompiledGLSLShader::setupProperties(OpenGLRenderer &rend, VariantScope &env) const");
+
+    for (const BindingPlanEntry &entry : this->bindingPlan) {
+        if (env.has(entry.nameId)) {
+            entry.apply(env.get(entry.nameId));
         }
     }
+}
+
+void CompiledGLSLShader::setupProperties(OpenGLRenderer &rend, VariantScope &envProperties,
+                                         const Material &material) const
+{
+    MMETER_SCOPE_PROFILER("CompiledGLSLShader::setupProperties(OpenGLRenderer &rend, VariantScope "
+                          "&envProperties, const Material &material) const");
 
-    for (auto [propertyNameId, ssboSpec] : this->ssboSpecs) {
-        if (auto nameValIt = matProperties.find(propertyNameId); nameValIt != matProperties.end()) {
-            // bind material variant buffer
-            rend.getTypeConversion(ssboSpec.srcSpec.typeInfo)
-                .setSSBOBinding(ssboSpec.bindingIndex, (*nameValIt).second);
-        } else if (envProperties.has(propertyNameId)) {
-            // bind context variant buffer
-            rend.getTypeConversion(ssboSpec.srcSpec.typeInfo)
-                .setSSBOBinding(ssboSpec.bindingIndex, envProperties.get(propertyNameId));
+    auto &matProperties = material.getProperties();
+
+    for (const BindingPlanEntry &entry : this->bindingPlan) {
+        if (auto nameValIt = matProperties.find(entry.nameId); nameValIt != matProperties.end()) {
+            // material variant value
+            entry.apply((*nameValIt).second);
+        } else if (envProperties.has(entry.nameId)) {
+            // context variant value
+            entry.apply(envProperties.get(entry.nameId));
         }
     }
 }
@@ -1034,82 +1825,354 @@ void CompiledGLSLShader::setupNonMaterialProperties(OpenGLRenderer &rend,
 
     auto &matProperties = firstMaterial.getProperties();
 
-    for (auto [propertyNameId, uniSpec] : this->uniformSpecs) {
-        if (matProperties.find(propertyNameId) == matProperties.end() &&
-            envProperties.has(propertyNameId)) {
-            // convert context variant to uniform
-            rend.getTypeConversion(uniSpec.srcSpec.typeInfo)
-                .setUniform(uniSpec.location, envProperties.get(propertyNameId));
+    for (const BindingPlanEntry &entry : this->bindingPlan) {
+        if (matProperties.find(entry.nameId) == matProperties.end() &&
+            envProperties.has(entry.nameId)) {
+            // context variant value
+            entry.apply(envProperties.get(entry.nameId));
         }
     }
+}
 
-    for (auto [propertyNameId, bindSpec] : this->opaqueBindingSpecs) {
-        if (matProperties.find(propertyNameId) == matProperties.end() &&
-            envProperties.has(propertyNameId)) {
-            // bind context variant
-            rend.getTypeConversion(bindSpec.srcSpec.typeInfo)
-                .setOpaqueBinding(bindSpec.bindingIndex, envProperties.get(propertyNameId));
+void CompiledGLSLShader::setupMaterialProperties(OpenGLRenderer &rend,
+                                                 const Material &material) const
+{
+    MMETER_SCOPE_PROFILER("CompiledGLSLShader::setupMaterialProperties(OpenGLRenderer &rend, const "
+                          "Material &material) const");
+
+    auto &matProperties = material.getProperties();
+
+    for (const BindingPlanEntry &entry : this->bindingPlan) {
+        if (auto nameValIt = matProperties.find(entry.nameId); nameValIt != matProperties.end()) {
+            // material variant value
+            entry.apply((*nameValIt).second);
         }
     }
+}
+
+/*
+Program registry
+*/
 
-    for (auto [propertyNameId, uboSpec] : this->uboSpecs) {
-        if (matProperties.find(propertyNameId) == matProperties.end() &&
-            envProperties.has(propertyNameId)) {
-            // bind context variant UBO
-            rend.getTypeConversion(uboSpec.srcSpec.typeInfo)
-                .setUBOBinding(uboSpec.bindingIndex, envProperties.get(propertyNameId));
+std::shared_ptr<CompiledGLSLShader::LinkedProgram> CompiledGLSLProgramRegistry::findOrInsert(
+    const String &sources, const std::shared_ptr<CompiledGLSLShader::LinkedProgram> &p_candidate)
+{
+    std::unique_lock lock(m_mutex);
+
+    ++m_stats.numRequests;
+    if (auto it = m_programs.find(sources); it != m_programs.end()) {
+        if (auto p_program = it->second.lock()) {
+            ++m_stats.numDeduplicated;
+            return p_program;
         }
     }
 
-    for (auto [propertyNameId, ssboSpec] : this->ssboSpecs) {
-        if (matProperties.find(propertyNameId) == matProperties.end() &&
-            envProperties.has(propertyNameId)) {
-            // bind context variant buffer
-            rend.getTypeConversion(ssboSpec.srcSpec.typeInfo)
-                .setSSBOBinding(ssboSpec.bindingIndex, envProperties.get(propertyNameId));
+    // forget the programs whose shaders are all gone
+    std::erase_if(m_programs, [](const auto &keyProgramPair) {
+        return keyProgramPair.second.expired();
+    });
+    m_programs[sources] = p_candidate;
+    return p_candidate;
+}
+
+CompiledGLSLProgramRegistry::Stats CompiledGLSLProgramRegistry::getStats() const
+{
+    std::unique_lock lock(m_mutex);
+
+    Stats stats = m_stats;
+    stats.numPrograms = std::count_if(m_programs.begin(), m_programs.end(),
+                                      [](const auto &keyProgramPair) {
+                                          return !keyProgramPair.second.expired();
+                                      });
+    return stats;
+}
+
+/*
+Pipeline memo
+*/
+
+CompiledGLSLPipelineMemo::CompiledGLSLPipelineMemo(std::size_t maxEntries)
+    : m_maxEntries(maxEntries)
+{}
+
+Pipeline<ShaderTask> CompiledGLSLPipelineMemo::getPipeline(
+    dynasma::FirmPtr<const Method<ShaderTask>> p_method, const ParamList &desiredOutputs,
+    const ParamAliases &aliases)
+{
+    MMETER_FUNC_PROFILER;
+
+    Key key{&*p_method, desiredOutputs.getHash(), aliases.hash()};
+
+    {
+        std::unique_lock lock(m_mutex);
+
+        ++m_stats.numRequests;
+        if (auto it = m_entryPerKey.find(key); it != m_entryPerKey.end()) {
+            ++m_stats.numHits;
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            return it->second->pipeline;
         }
+        ++m_stats.numMisses;
     }
+
+    // solve outside the lock; racing threads may both solve, but agree on the result
+    Pipeline<ShaderTask> pipeline(p_method, desiredOutputs, aliases);
+
+    std::unique_lock lock(m_mutex);
+
+    if (m_maxEntries == 0 || m_entryPerKey.contains(key)) {
+        return pipeline;
+    }
+
+    m_entries.push_front(Entry{
+        .key = key,
+        .p_method = p_method,
+        .pipeline = pipeline,
+    });
+    m_entryPerKey.emplace(key, m_entries.begin());
+
+    while (m_entries.size() > m_maxEntries) {
+        m_entryPerKey.erase(m_entries.back().key);
+        m_entries.pop_back();
+        ++m_stats.numEvictions;
+    }
+
+    return pipeline;
 }
 
-void CompiledGLSLShader::setupMaterialProperties(OpenGLRenderer &rend,
-                                                 const Material &material) const
+CompiledGLSLPipelineMemo::Stats CompiledGLSLPipelineMemo::getStats() const
 {
-    MMETER_SCOPE_PROFILER("CompiledGLSLShader::setupMaterialProperties(OpenGLRenderer &rend, const "
-                          "Material &material) const");
+    std::unique_lock lock(m_mutex);
 
-    auto &matProperties = material.getProperties();
+    Stats stats = m_stats;
+    stats.numEntries = m_entries.size();
+    return stats;
+}
+
+void CompiledGLSLPipelineMemo::clear()
+{
+    std::unique_lock lock(m_mutex);
 
-    for (auto [propertyNameId, uniSpec] : this->uniformSpecs) {
-        if (auto nameValIt = matProperties.find(propertyNameId); nameValIt != matProperties.end()) {
-            // convert material variant to uniform
-            rend.getTypeConversion(uniSpec.srcSpec.typeInfo)
-                .setUniform(uniSpec.location, (*nameValIt).second);
+    m_entryPerKey.clear();
+    m_entries.clear();
+}
+
+/*
+Prebuilds
+*/
+
+CompiledGLSLShaderPrebuilds::CompiledGLSLShaderPrebuilds(OpenGLRenderer &rend) : m_renderer(rend)
+{}
+
+void CompiledGLSLShaderPrebuilds::prebuild(const CompiledGLSLShaderCacherSeed &seed)
+{
+    std::unique_lock lock(m_mutex);
+
+    if (m_builds.find(seed) != m_builds.end()) {
+        return;
+    }
+    if (auto it = m_liveSeeds.find(seed); it != m_liveSeeds.end()) {
+        if (!it->second.expired()) {
+            // the cacher already holds the program
+            return;
         }
+        m_liveSeeds.erase(it);
     }
 
-    for (auto [propertyNameId, bindSpec] : this->opaqueBindingSpecs) {
-        if (auto nameValIt = matProperties.find(propertyNameId); nameValIt != matProperties.end()) {
-            // bind material variant
-            rend.getTypeConversion(bindSpec.srcSpec.typeInfo)
-                .setOpaqueBinding(bindSpec.bindingIndex, (*nameValIt).second);
-        }
+    m_builds.emplace(seed, m_renderer.getShaderBuildPool().submit([seed]() {
+        return std::visit(
+            [](const auto &params) { return CompiledGLSLShader::buildSources(params); },
+            seed.kernel);
+    }));
+}
+
+std::optional<std::future<CompiledGLSLShader::SourceBuild>> CompiledGLSLShaderPrebuilds::take(
+    const CompiledGLSLShaderCacherSeed &seed)
+{
+    std::unique_lock lock(m_mutex);
+
+    auto it = m_builds.find(seed);
+    if (it == m_builds.end()) {
+        return std::nullopt;
+    }
+
+    std::future<CompiledGLSLShader::SourceBuild> build = std::move(it->second);
+    m_builds.erase(it);
+    return build;
+}
+
+void CompiledGLSLShaderPrebuilds::drop(const CompiledGLSLShaderCacherSeed &seed)
+{
+    // the build may still reference the seed's aliases, so wait for it outside the lock
+    if (auto build = take(seed); build.has_value()) {
+        build->wait();
+    }
+}
+
+void CompiledGLSLShaderPrebuilds::clear()
+{
+    std::map<CompiledGLSLShaderCacherSeed, std::future<CompiledGLSLShader::SourceBuild>> builds;
+    {
+        std::unique_lock lock(m_mutex);
+        std::swap(builds, m_builds);
+    }
+
+    for (auto &[seed, build] : builds) {
+        build.wait();
+    }
+}
+
+std::shared_ptr<const bool> CompiledGLSLShaderPrebuilds::markLive(
+    const CompiledGLSLShaderCacherSeed &seed)
+{
+    std::unique_lock lock(m_mutex);
+
+    std::erase_if(m_liveSeeds, [](const auto &seedTokenPair) {
+        return seedTokenPair.second.expired();
+    });
+
+    auto p_token = std::make_shared<const bool>(true);
+    m_liveSeeds.insert_or_assign(seed, p_token);
+    return p_token;
+}
+
+/*
+Warm-up
+*/
+
+CompiledGLSLShaderWarmUp::CompiledGLSLShaderWarmUp(ComponentRoot &root)
+    : m_root(root), m_numCreated(0), m_numDone(0)
+{}
+
+CompiledGLSLShaderWarmUp::~CompiledGLSLShaderWarmUp()
+{
+    // the builds of programs that never got created reference our aliases
+    OpenGLRenderer &rend = static_cast<OpenGLRenderer &>(m_root.getComponent<Renderer>());
+    for (std::size_t i = m_numCreated; i < m_entries.size(); ++i) {
+        rend.getShaderPrebuilds().drop(m_entries[i].seed);
+    }
+}
+
+void CompiledGLSLShaderWarmUp::addSurfaceShader(const ParamAliases &aliases,
+                                                String vertexPositionOutputName,
+                                                const ParamList &fragmentOutputs,
+                                                ReadyCallback onReady,
+                                                const GLProgramSpecialization &specialization)
+{
+    queue(Entry{
+        .seed = {CompiledGLSLShader::SurfaceShaderParams(
+            aliases, vertexPositionOutputName, fragmentOutputs, m_root, specialization)},
+        .onReady = std::move(onReady),
+    });
+}
+
+void CompiledGLSLShaderWarmUp::addComputeShader(const ParamAliases &aliases,
+                                                const ParamList &desiredResults,
+                                                ArgumentGetter<std::uint32_t> invocationCountX,
+                                                ArgumentGetter<std::uint32_t> invocationCountY,
+                                                ArgumentGetter<std::uint32_t> invocationCountZ,
+                                                glm::uvec3 groupSize, bool allowOutOfBoundsCompute,
+                                                ReadyCallback onReady)
+{
+    queue(Entry{
+        .seed = {CompiledGLSLShader::ComputeShaderParams(
+            m_root, aliases, desiredResults, invocationCountX, invocationCountY, invocationCountZ,
+            groupSize, allowOutOfBoundsCompute)},
+        .onReady = std::move(onReady),
+    });
+}
+
+const ParamAliases &CompiledGLSLShaderWarmUp::keepAliases(ParamAliases &&aliases)
+{
+    return m_keptAliases.emplace_back(std::move(aliases));
+}
+
+void CompiledGLSLShaderWarmUp::queue(Entry &&entry)
+{
+    OpenGLRenderer &rend = static_cast<OpenGLRenderer &>(m_root.getComponent<Renderer>());
+    rend.getShaderPrebuilds().prebuild(entry.seed);
+    m_entries.push_back(std::move(entry));
+}
+
+bool CompiledGLSLShaderWarmUp::update(std::optional<std::chrono::steady_clock::duration> timeBudget)
+{
+    MMETER_FUNC_PROFILER;
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    // create programs in the order they were queued, as their code is likely ready in that order
+    while (m_numCreated < m_entries.size() &&
+           (!timeBudget.has_value() ||
+            std::chrono::steady_clock::now() - startTime < *timeBudget)) {
+        create(m_entries[m_numCreated++]);
     }
 
-    for (auto [propertyNameId, uboSpec] : this->uboSpecs) {
-        if (auto nameValIt = matProperties.find(propertyNameId); nameValIt != matProperties.end()) {
-            // bind material variant UBO
-            rend.getTypeConversion(uboSpec.srcSpec.typeInfo)
-                .setUBOBinding(uboSpec.bindingIndex, (*nameValIt).second);
+    for (std::size_t i = 0; i < m_numCreated; ++i) {
+        Entry &entry = m_entries[i];
+        if (!entry.done && (*entry.p_shader)->isReady()) {
+            markDone(entry);
         }
     }
 
-    for (auto [propertyNameId, ssboSpec] : this->ssboSpecs) {
-        if (auto nameValIt = matProperties.find(propertyNameId); nameValIt != matProperties.end()) {
-            // bind material variant buffer
-            rend.getTypeConversion(ssboSpec.srcSpec.typeInfo)
-                .setSSBOBinding(ssboSpec.bindingIndex, (*nameValIt).second);
+    return m_numDone == m_entries.size();
+}
+
+void CompiledGLSLShaderWarmUp::finish()
+{
+    MMETER_FUNC_PROFILER;
+
+    // start all links before waiting on any, so they overlap
+    while (m_numCreated < m_entries.size()) {
+        create(m_entries[m_numCreated++]);
+    }
+
+    for (Entry &entry : m_entries) {
+        if (!entry.done) {
+            (*entry.p_shader)->waitUntilReady();
+            markDone(entry);
         }
     }
 }
 
+std::size_t CompiledGLSLShaderWarmUp::getNumDone() const
+{
+    return m_numDone;
+}
+
+std::size_t CompiledGLSLShaderWarmUp::getNumQueued() const
+{
+    return m_entries.size();
+}
+
+float CompiledGLSLShaderWarmUp::getProgress() const
+{
+    return m_entries.empty() ? 1.0f : (float)m_numDone / m_entries.size();
+}
+
+void CompiledGLSLShaderWarmUp::create(Entry &entry)
+{
+    OpenGLRenderer &rend = static_cast<OpenGLRenderer &>(m_root.getComponent<Renderer>());
+    CompiledGLSLShaderCacher &shaderCacher = m_root.getComponent<CompiledGLSLShaderCacher>();
+    try {
+        entry.p_shader = shaderCacher.retrieve_asset(entry.seed);
+    }
+    catch (const std::exception &e) {
+        m_root.getErrStream() << "During shader warm-up: " << e.what() << std::endl;
+        markDone(entry);
+    }
+
+    // a cached program or a failed creation leaves the build untaken
+    rend.getShaderPrebuilds().drop(entry.seed);
+}
+
+void CompiledGLSLShaderWarmUp::markDone(Entry &entry)
+{
+    entry.done = true;
+    ++m_numDone;
+
+    if (entry.onReady && entry.p_shader.has_value()) {
+        entry.onReady(**entry.p_shader);
+    }
+}
+
 } // namespace Vitrae
\ No newline at end of file
@@ -18,9 +18,25 @@ OpenGLShaderHeader::OpenGLShaderHeader(const FileLoadParams &params)
     std::ostringstream sstr;
     sstr << stream.rdbuf();
     m_params.snippet = clearIndents(sstr.str());
+
+    tokenizeSnippet();
 }
 
-OpenGLShaderHeader::OpenGLShaderHeader(const StringParams &params) : m_params(params) {}
+OpenGLShaderHeader::OpenGLShaderHeader(const StringParams &params) : m_params(params)
+{
+    tokenizeSnippet();
+}
+
+void OpenGLShaderHeader::tokenizeSnippet()
+{
+    for (const ParamList *p_specs : {&m_params.inputSpecs, &m_params.outputSpecs,
+                                     &m_params.filterSpecs, &m_params.consumingSpecs}) {
+        for (const auto &spec : p_specs->getSpecList()) {
+            m_paramNames.push_back(spec.name);
+        }
+    }
+    m_snippet = GLTokenizedCode(m_params.snippet, m_paramNames);
+}
 
 std::size_t OpenGLShaderHeader::memory_cost() const
 {
@@ -67,33 +83,14 @@ void OpenGLShaderHeader::extractSubTasks(std::set<const Task *> &taskSet,
 
 void OpenGLShaderHeader::outputDeclarationCode(BuildContext args) const
 {
-    for (auto p_specs : {
-             &m_params.inputSpecs,
-             &m_params.outputSpecs,
-             &m_params.filterSpecs,
-             &m_params.consumingSpecs,
-         }) {
-        for (auto &spec : p_specs->getSpecList()) {
-            if (spec.name != args.aliases.choiceStringFor(spec.name)) {
-                args.output << "#define " << spec.name << " "
-                            << args.aliases.choiceStringFor(spec.name) << "\n";
-            }
-        }
-    }
-    args.output << m_params.snippet;
-
-    for (auto p_specs : {
-             &m_params.inputSpecs,
-             &m_params.outputSpecs,
-             &m_params.filterSpecs,
-             &m_params.consumingSpecs,
-         }) {
-        for (auto &spec : p_specs->getSpecList()) {
-            if (spec.name != args.aliases.choiceStringFor(spec.name)) {
-                args.output << "#undef " << spec.name << "\n";
-            }
-        }
+    // substitute the aliases directly, instead of wrapping the snippet in #defines
+    std::vector<String> replacements;
+    replacements.reserve(m_paramNames.size());
+    for (const String &name : m_paramNames) {
+        replacements.push_back(args.aliases.choiceStringFor(name));
     }
+
+    m_snippet.write(args.output, replacements);
 }
 
 void OpenGLShaderHeader::outputDefinitionCode(BuildContext args) const {}
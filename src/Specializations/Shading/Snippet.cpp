@@ -6,10 +6,25 @@
 
 namespace Vitrae {
 
+namespace {
+std::vector<String> getParamNames(std::initializer_list<const ParamList *> specLists)
+{
+    std::vector<String> names;
+    for (auto p_specs : specLists) {
+        for (auto &spec : p_specs->getSpecList()) {
+            names.push_back(spec.name);
+        }
+    }
+    return names;
+}
+} // namespace
+
 OpenGLShaderSnippet::OpenGLShaderSnippet(const StringParams &params)
     : m_inputSpecs(params.inputSpecs), m_outputSpecs(params.outputSpecs),
       m_filterSpecs(params.filterSpecs), m_consumingSpecs(params.consumingSpecs),
-      m_snippet(clearIndents(params.snippet))
+      m_paramNames(getParamNames(
+          {&params.inputSpecs, &params.outputSpecs, &params.filterSpecs, &params.consumingSpecs})),
+      m_snippet(clearIndents(params.snippet), m_paramNames)
 {
     m_friendlyName = "Produce:\n";
 
@@ -71,36 +86,16 @@ void OpenGLShaderSnippet::outputDefinitionCode(BuildContext args) const {}
 
 void OpenGLShaderSnippet::outputUsageCode(BuildContext args) const
 {
-    for (auto p_specs : {
-             &m_inputSpecs,
-             &m_outputSpecs,
-             &m_filterSpecs,
-             &m_consumingSpecs,
-         }) {
-        for (auto &spec : p_specs->getSpecList()) {
-            if (spec.name != args.aliases.choiceStringFor(spec.name)) {
-                args.output << "#define " << spec.name << " "
-                            << args.aliases.choiceStringFor(spec.name) << "\n";
-            }
-        }
+    // substitute the aliases directly, instead of wrapping the snippet in #defines
+    std::vector<String> replacements;
+    replacements.reserve(m_paramNames.size());
+    for (const String &name : m_paramNames) {
+        replacements.push_back(args.aliases.choiceStringFor(name));
     }
 
     args.output << "{\n";
-    args.output << m_snippet;
+    m_snippet.write(args.output, replacements);
     args.output << "}\n";
-
-    for (auto p_specs : {
-             &m_inputSpecs,
-             &m_outputSpecs,
-             &m_filterSpecs,
-             &m_consumingSpecs,
-         }) {
-        for (auto &spec : p_specs->getSpecList()) {
-            if (spec.name != args.aliases.choiceStringFor(spec.name)) {
-                args.output << "#undef " << spec.name << "\n";
-            }
-        }
-    }
 }
 
 StringView OpenGLShaderSnippet::getFriendlyName() const {
@@ -1,4 +1,7 @@
 #include "VitraePluginOpenGL/Specializations/SharedBuffer.hpp"
+#include "Vitrae/Collections/ComponentRoot.hpp"
+#include "VitraePluginOpenGL/Bits/StateCache.hpp"
+#include "VitraePluginOpenGL/Specializations/Renderer.hpp"
 
 #include "MMeter.h"
 
@@ -6,9 +9,15 @@ namespace Vitrae
 {
 
 OpenGLRawSharedBuffer::OpenGLRawSharedBuffer(const SetupParams &params)
-    : RawSharedBuffer(), m_usage(params.usage)
+    : RawSharedBuffer(), m_usage(params.usage),
+      m_maxUBOSize(static_cast<OpenGLRenderer &>(params.root.getComponent<Renderer>())
+                       .getCapabilities()
+                       .maxUniformBlockSize),
+      m_memoryLedger(
+          static_cast<OpenGLRenderer &>(params.root.getComponent<Renderer>()).getMemoryLedger()),
+      m_gpuSize(0)
 {
-    glGenBuffers(1, &m_glBufferHandle);
+    glCreateBuffers(1, &m_glBufferHandle);
     String glLabel = String("Buffer ") + params.friendlyName;
     glObjectLabel(GL_BUFFER, m_glBufferHandle, glLabel.size(), glLabel.data());
 
@@ -23,7 +32,11 @@ OpenGLRawSharedBuffer::OpenGLRawSharedBuffer(const SetupParams &params)
 
 OpenGLRawSharedBuffer::~OpenGLRawSharedBuffer()
 {
+    if (GLStateCache *p_stateCache = GLStateCache::tryCurrent()) {
+        p_stateCache->forgetBuffer(m_glBufferHandle);
+    }
     glDeleteBuffers(1, &m_glBufferHandle);
+    m_memoryLedger.remove(GLMemoryCategory::Buffers, m_gpuSize);
 }
 
 void OpenGLRawSharedBuffer::synchronize()
@@ -52,6 +65,7 @@ void OpenGLRawSharedBuffer::requestBufferPtr() const
 {
     if (!m_bufferPtr) {
         m_bufferPtr = (Byte *)glMapNamedBuffer(m_glBufferHandle, GL_READ_WRITE);
+        ++GLRenderStats::currentCounters().bufferMaps;
         m_dirtySpan = {0, 0};
     }
 }
@@ -63,9 +77,11 @@ void OpenGLRawSharedBuffer::requestResizeBuffer(std::size_t size) const
         glUnmapNamedBuffer(m_glBufferHandle);
         m_bufferPtr = nullptr;
     }
-    glBindBuffer(getGlTarget(), m_glBufferHandle);
-    glBufferData(getGlTarget(), size, nullptr, getGlUsage());
-    glBindBuffer(getGlTarget(), 0);
+    glNamedBufferData(m_glBufferHandle, size, nullptr, getGlUsage());
+
+    m_memoryLedger.remove(GLMemoryCategory::Buffers, m_gpuSize);
+    m_gpuSize = size;
+    m_memoryLedger.add(GLMemoryCategory::Buffers, m_gpuSize);
 }
 
 GLenum OpenGLRawSharedBuffer::getGlUsage() const
@@ -105,16 +121,7 @@ GLenum OpenGLRawSharedBuffer::getGlUsage() const
 
 GLenum OpenGLRawSharedBuffer::getGlTarget() const
 {
-    constexpr GLint maxUBOSize = 16000; // ~16kb
-    /*
-    To get the proper size of the UBO, use:
-    []() {
-        GLint size;
-        glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &size);
-        return size;
-    }();
-    */
-    if (m_size >= maxUBOSize || m_usage & BufferUsageHint::GPU_COMPUTE) {
+    if (m_size > (std::size_t)m_maxUBOSize || m_usage & BufferUsageHint::GPU_COMPUTE) {
         return GL_SHADER_STORAGE_BUFFER;
     } else {
         return GL_UNIFORM_BUFFER;
@@ -123,7 +130,7 @@ GLenum OpenGLRawSharedBuffer::getGlTarget() const
 
 std::size_t OpenGLRawSharedBuffer::memory_cost() const
 {
-    return sizeof(*this) + m_size;
+    return sizeof(*this) + m_gpuSize;
 }
 
 } // namespace Vitrae
\ No newline at end of file
@@ -4,12 +4,54 @@
 
 #include "stb/stb_image.h"
 
+#include <algorithm>
+#include <bit>
 #include <map>
 #include <vector>
 
+namespace
+{
+std::size_t getBytesPerTexel(GLint internalFormat)
+{
+    switch (internalFormat) {
+    case GL_R8:
+    case GL_R8_SNORM:
+        return 1;
+    case GL_RG8:
+    case GL_RG8_SNORM:
+    case GL_R16F:
+        return 2;
+    case GL_RGB8:
+    case GL_RGB8_SNORM:
+        return 3;
+    case GL_RGBA8:
+    case GL_RGBA8_SNORM:
+    case GL_RG16F:
+    case GL_R32F:
+    case GL_DEPTH_COMPONENT32F:
+        return 4;
+    case GL_RGB16F:
+        return 6;
+    case GL_RGBA16F:
+    case GL_RG32F:
+        return 8;
+    case GL_RGB32F:
+        return 12;
+    case GL_RGBA32F:
+        return 16;
+    default:
+        return 4;
+    }
+}
+} // namespace
+
 namespace Vitrae
 {
-OpenGLTexture::OpenGLTexture(const TextureFilteringParams &filtering) : m_sentToGPU(false)
+OpenGLTexture::OpenGLTexture(ComponentRoot &root, const TextureFilteringParams &filtering)
+    : m_sentToGPU(false),
+      m_memoryLedger(
+          static_cast<OpenGLRenderer &>(root.getComponent<Renderer>()).getMemoryLedger()),
+      m_gpuMemoryCost(0)
 {
     switch (filtering.horWrap) {
     case WrappingType::BORDER_COLOR:
@@ -70,7 +112,8 @@ OpenGLTexture::OpenGLTexture(const TextureFilteringParams &filtering) : m_sentTo
     mBorderColor = filtering.borderColor;
 }
 
-OpenGLTexture::OpenGLTexture(const FileLoadParams &params) : OpenGLTexture(params.filtering)
+OpenGLTexture::OpenGLTexture(const FileLoadParams &params)
+    : OpenGLTexture(params.root, params.filtering)
 {
     int stbChannelFormat;
     unsigned char *data =
@@ -84,7 +127,7 @@ OpenGLTexture::OpenGLTexture(const FileLoadParams &params) : OpenGLTexture(param
     mUseSwizzle = false;
     switch (stbChannelFormat) {
     case STBI_grey:
-        mGLInternalFormat = GL_RED;
+        mGLInternalFormat = GL_R8;
         mGLChannelFormat = GL_RED;
         mSwizzle = {GL_RED, GL_RED, GL_RED, GL_ONE};
         mUseSwizzle = true;
@@ -98,7 +141,7 @@ OpenGLTexture::OpenGLTexture(const FileLoadParams &params) : OpenGLTexture(param
     case STBI_grey_alpha:
         params.root.getWarningStream()
             << "Texture load cannot convert from gray_alpha format; red_green used!" << std::endl;
-        mGLInternalFormat = GL_RG;
+        mGLInternalFormat = GL_RG8;
         mGLChannelFormat = GL_RG;
         mSwizzle = {GL_RED, GL_RED, GL_RED, GL_GREEN};
         mUseSwizzle = true;
@@ -111,7 +154,7 @@ OpenGLTexture::OpenGLTexture(const FileLoadParams &params) : OpenGLTexture(param
 
         break;
     case STBI_rgb:
-        mGLInternalFormat = GL_RGB;
+        mGLInternalFormat = GL_RGB8;
         mGLChannelFormat = GL_RGB;
 
         for (int i = 0; i < mWidth * mHeight * 3; i += 3) {
@@ -121,7 +164,7 @@ OpenGLTexture::OpenGLTexture(const FileLoadParams &params) : OpenGLTexture(param
         m_stats.value().averageColor /= mWidth * mHeight;
         break;
     case STBI_rgb_alpha:
-        mGLInternalFormat = GL_RGBA;
+        mGLInternalFormat = GL_RGBA8;
         mGLChannelFormat = GL_RGBA;
 
         for (int i = 0; i < mWidth * mHeight * 4; i += 4) {
@@ -145,38 +188,39 @@ OpenGLTexture::OpenGLTexture(const FileLoadParams &params) : OpenGLTexture(param
     }
 }
 
-OpenGLTexture::OpenGLTexture(const EmptyParams &params) : OpenGLTexture(params.filtering)
+OpenGLTexture::OpenGLTexture(const EmptyParams &params)
+    : OpenGLTexture(params.root, params.filtering)
 {
     m_stats.reset();
 
     mUseSwizzle = false;
     switch (params.format) {
     case BufferFormat::GRAYSCALE_STANDARD:
-        mGLInternalFormat = GL_RED;
+        mGLInternalFormat = GL_R8;
         mGLChannelFormat = GL_RED;
         mSwizzle = {GL_RED, GL_RED, GL_RED, GL_ONE};
         mUseSwizzle = true;
         mGLChannelType = GL_UNSIGNED_BYTE;
         break;
     case BufferFormat::GRAYSCALE_ALPHA_STANDARD:
-        mGLInternalFormat = GL_RG;
+        mGLInternalFormat = GL_RG8;
         mGLChannelFormat = GL_RG;
         mSwizzle = {GL_RED, GL_RED, GL_RED, GL_GREEN};
         mUseSwizzle = true;
         mGLChannelType = GL_UNSIGNED_BYTE;
         break;
     case BufferFormat::RGB_STANDARD:
-        mGLInternalFormat = GL_RGB;
+        mGLInternalFormat = GL_RGB8;
         mGLChannelFormat = GL_RGB;
         mGLChannelType = GL_UNSIGNED_BYTE;
         break;
     case BufferFormat::RGBA_STANDARD:
-        mGLInternalFormat = GL_RGBA;
+        mGLInternalFormat = GL_RGBA8;
         mGLChannelFormat = GL_RGBA;
         mGLChannelType = GL_UNSIGNED_BYTE;
         break;
     case BufferFormat::DEPTH_STANDARD:
-        mGLInternalFormat = GL_DEPTH_COMPONENT;
+        mGLInternalFormat = GL_DEPTH_COMPONENT32F;
         mGLChannelFormat = GL_DEPTH_COMPONENT;
         mGLChannelType = GL_FLOAT;
         break;
@@ -269,7 +313,7 @@ OpenGLTexture::OpenGLTexture(const EmptyParams &params) : OpenGLTexture(params.f
 }
 
 OpenGLTexture::OpenGLTexture(const PureColorParams &params)
-    : OpenGLTexture(TextureFilteringParams{
+    : OpenGLTexture(params.root, TextureFilteringParams{
           WrappingType::REPEAT,
           WrappingType::REPEAT,
           FilterType::NEAREST,
@@ -279,7 +323,7 @@ OpenGLTexture::OpenGLTexture(const PureColorParams &params)
       })
 {
     mUseSwizzle = false;
-    mGLInternalFormat = GL_RGBA;
+    mGLInternalFormat = GL_RGBA8;
     mGLChannelFormat = GL_RGBA;
     mGLChannelType = GL_UNSIGNED_BYTE;
 
@@ -308,31 +352,45 @@ OpenGLTexture::~OpenGLTexture()
 
 std::size_t OpenGLTexture::memory_cost() const
 {
-    return mWidth * mHeight * 3; /// TODO: properly calculate num channels
+    return sizeof(*this) + m_gpuMemoryCost;
 }
 
 void OpenGLTexture::loadToGPU(const unsigned char *data, StringView friendlyName)
 {
     if (!m_sentToGPU) {
         m_sentToGPU = true;
-        glGenTextures(1, &glTextureId);
-        glBindTexture(GL_TEXTURE_2D, glTextureId);
-
-        glTexImage2D(GL_TEXTURE_2D, 0, mGLInternalFormat, mWidth, mHeight, 0, mGLChannelFormat,
-                     mGLChannelType, data);
+        // DSA, so the texture bindings known to the state cache don't change
+        glCreateTextures(GL_TEXTURE_2D, 1, &glTextureId);
+
+        GLsizei width = std::max(mWidth, 1);
+        GLsizei height = std::max(mHeight, 1);
+        GLsizei numLevels =
+            mUseMipMaps ? std::bit_width((unsigned int)std::max(width, height)) : 1;
+        glTextureStorage2D(glTextureId, numLevels, mGLInternalFormat, width, height);
+
+        m_gpuMemoryCost = 0;
+        for (GLsizei level = 0; level < numLevels; ++level) {
+            m_gpuMemoryCost += (std::size_t)std::max(width >> level, 1) *
+                               std::max(height >> level, 1) * getBytesPerTexel(mGLInternalFormat);
+        }
+        m_memoryLedger.add(GLMemoryCategory::Textures, m_gpuMemoryCost);
+        if (data) {
+            glTextureSubImage2D(glTextureId, 0, 0, 0, width, height, mGLChannelFormat,
+                                mGLChannelType, data);
+        }
 
         if (mUseSwizzle) {
-            glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, mSwizzleArr);
+            glTextureParameteriv(glTextureId, GL_TEXTURE_SWIZZLE_RGBA, mSwizzleArr);
+        }
+        glTextureParameteri(glTextureId, GL_TEXTURE_MAG_FILTER, mGLMagFilter);
+        glTextureParameteri(glTextureId, GL_TEXTURE_MIN_FILTER, mGLMinFilter);
+        glTextureParameteri(glTextureId, GL_TEXTURE_WRAP_S, mGLWrapS);
+        glTextureParameteri(glTextureId, GL_TEXTURE_WRAP_T, mGLWrapT);
+        glTextureParameterfv(glTextureId, GL_TEXTURE_BORDER_COLOR, &mBorderColor[0]);
+
+        if (mUseMipMaps) {
+            glGenerateTextureMipmap(glTextureId);
         }
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mGLMagFilter);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mGLMinFilter);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, mGLWrapS);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, mGLWrapT);
-        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, &mBorderColor[0]);
-
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glBindTexture(GL_TEXTURE_2D, 0);
 
         String glLabel = String("texture ") + String(friendlyName);
         glObjectLabel(GL_TEXTURE, glTextureId, glLabel.size(), glLabel.data());
@@ -343,7 +401,12 @@ void OpenGLTexture::unloadFromGPU()
 {
     if (m_sentToGPU) {
         m_sentToGPU = false;
+        if (GLStateCache *p_stateCache = GLStateCache::tryCurrent()) {
+            p_stateCache->forgetTexture(glTextureId);
+        }
         glDeleteTextures(1, &glTextureId);
+        m_memoryLedger.remove(GLMemoryCategory::Textures, m_gpuMemoryCost);
+        m_gpuMemoryCost = 0;
     }
 }
 
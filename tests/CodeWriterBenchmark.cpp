@@ -0,0 +1,225 @@
+#include "VitraePluginOpenGL/Bits/CodeWriter.hpp"
+#include "VitraePluginOpenGL/Bits/TokenizedCode.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <vector>
+
+using namespace Vitrae;
+
+namespace
+{
+std::atomic<std::size_t> g_numAllocations = 0;
+} // namespace
+
+void *operator new(std::size_t size)
+{
+    g_numAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+constexpr std::size_t NUM_VARIANTS = 4000;
+constexpr std::size_t NUM_STAGES = 2;
+
+// snippets as shader tasks typically have them, with their params' identifiers
+struct SnippetSpec
+{
+    const char *code;
+    std::vector<String> paramNames;
+};
+
+const std::array<SnippetSpec, 4> SNIPPETS = {{
+    {"void transformPosition() {\n"
+     "    position_view = mat_view * mat_model * vec4(position, 1.0);\n"
+     "    gl_Position = mat_proj * position_view;\n"
+     "}\n",
+     {"position_view", "mat_view", "mat_model", "position", "mat_proj"}},
+    {"void transformNormal() {\n"
+     "    // normal matrix, without the translation of mat_model\n"
+     "    normal_view = normalize(mat3(mat_view * mat_model) * normal);\n"
+     "}\n",
+     {"normal_view", "mat_view", "mat_model", "normal"}},
+    {"void shadeLambert() {\n"
+     "    float light = max(dot(normal_view, light_dir_view), 0.0) * 1.0e-0f + 0.05;\n"
+     "    shade = color_diffuse * light;\n"
+     "}\n",
+     {"shade", "color_diffuse", "normal_view", "light_dir_view"}},
+    {"void tonemap() {\n"
+     "    color_out = vec4(shade / (shade + vec3(1.0)), 1.0);\n"
+     "}\n",
+     {"color_out", "shade"}},
+}};
+
+// what the names resolve to in a variant, like different aliases of materials would
+std::vector<String> replacementsFor(const SnippetSpec &snippet, std::size_t variant)
+{
+    std::vector<String> replacements;
+    for (const String &name : snippet.paramNames) {
+        replacements.push_back("v_" + name + "_" + std::to_string(variant % 37));
+    }
+    return replacements;
+}
+
+struct Result
+{
+    std::size_t numAllocations;
+    std::chrono::nanoseconds duration;
+    std::size_t codeSize;
+};
+
+/*
+The code as it used to be written: a fresh stringstream per stage,
+with #define/#undef pairs around each snippet, and copied out with str()
+*/
+Result writeWithStringstreams(const std::vector<std::vector<std::vector<String>>> &replacements)
+{
+    Result result{};
+    std::size_t startAllocations = g_numAllocations.load();
+    auto startTime = std::chrono::steady_clock::now();
+
+    for (std::size_t variant = 0; variant < NUM_VARIANTS; ++variant) {
+        for (std::size_t stage = 0; stage < NUM_STAGES; ++stage) {
+            std::stringstream ss;
+            ss << "#version 450\n";
+            for (std::size_t s = 0; s < SNIPPETS.size(); ++s) {
+                const SnippetSpec &snippet = SNIPPETS[s];
+                const std::vector<String> &snippetReplacements = replacements[variant][s];
+                for (std::size_t p = 0; p < snippet.paramNames.size(); ++p) {
+                    ss << "#define " << snippet.paramNames[p] << " " << snippetReplacements[p]
+                       << "\n";
+                }
+                ss << snippet.code;
+                for (const String &name : snippet.paramNames) {
+                    ss << "#undef " << name << "\n";
+                }
+            }
+            String code = ss.str();
+            result.codeSize += code.size();
+        }
+    }
+
+    result.duration = std::chrono::steady_clock::now() - startTime;
+    result.numAllocations = g_numAllocations.load() - startAllocations;
+    return result;
+}
+
+/*
+The code as buildSources writes it now: a reused per-thread writer, tokenized snippets,
+and interned identifiers
+*/
+Result writeWithCodeWriter(const std::vector<std::vector<std::vector<String>>> &replacements,
+                           const std::vector<GLTokenizedCode> &tokenizedSnippets,
+                           GLCodeWriter &writer, bool &failed)
+{
+    Result result{};
+    std::size_t startAllocations = g_numAllocations.load();
+    auto startTime = std::chrono::steady_clock::now();
+
+    for (std::size_t variant = 0; variant < NUM_VARIANTS; ++variant) {
+        writer.reset();
+        for (std::size_t stage = 0; stage < NUM_STAGES; ++stage) {
+            writer.clearCode();
+            std::stringstream &ss = writer.stream();
+            ss << "#version 450\n";
+            for (std::size_t s = 0; s < SNIPPETS.size(); ++s) {
+                ss << "out vec4 " << writer.intern("out_", SNIPPETS[s].paramNames[0]) << ";\n";
+                tokenizedSnippets[s].write(ss, replacements[variant][s]);
+            }
+            String code(writer.getCode());
+            result.codeSize += code.size();
+
+            if (variant == 0 && stage == 0 && code.find(replacements[0][0][0]) == String::npos) {
+                std::cerr << "Written code misses the replaced identifiers:\n" << code << std::endl;
+                failed = true;
+            }
+        }
+    }
+
+    result.duration = std::chrono::steady_clock::now() - startTime;
+    result.numAllocations = g_numAllocations.load() - startAllocations;
+    return result;
+}
+
+void printResult(const char *name, const Result &result)
+{
+    std::cout << name << ", " << NUM_VARIANTS << ", "
+              << (double)result.numAllocations / NUM_VARIANTS << ", "
+              << (double)result.duration.count() / NUM_VARIANTS << std::endl;
+}
+} // namespace
+
+/*
+Measures allocations and time per program variant when generating GLSL code,
+with the reused code writer and with fresh stringstreams
+*/
+int main()
+{
+    bool failed = false;
+
+    std::vector<GLTokenizedCode> tokenizedSnippets;
+    for (const SnippetSpec &snippet : SNIPPETS) {
+        tokenizedSnippets.emplace_back(snippet.code, snippet.paramNames);
+    }
+
+    std::vector<std::vector<std::vector<String>>> replacements(NUM_VARIANTS);
+    for (std::size_t variant = 0; variant < NUM_VARIANTS; ++variant) {
+        for (const SnippetSpec &snippet : SNIPPETS) {
+            replacements[variant].push_back(replacementsFor(snippet, variant));
+        }
+    }
+
+    // warm up the writer, as the per-thread one is after the first program
+    GLCodeWriter writer;
+    writeWithCodeWriter(replacements, tokenizedSnippets, writer, failed);
+
+    Result streamResult = writeWithStringstreams(replacements);
+    Result writerResult = writeWithCodeWriter(replacements, tokenizedSnippets, writer, failed);
+
+    std::cout << "method, variants, allocations per variant, ns per variant" << std::endl;
+    printResult("stringstream", streamResult);
+    printResult("code writer", writerResult);
+
+    // each stage's code gets copied out once, and each distinct identifier takes a set node;
+    // anything more is a regression
+    if (writerResult.numAllocations > NUM_VARIANTS * (NUM_STAGES + SNIPPETS.size())) {
+        std::cerr << "The code writer allocated more than expected" << std::endl;
+        failed = true;
+    }
+
+    return failed ? 1 : 0;
+}
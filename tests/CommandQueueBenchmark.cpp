@@ -0,0 +1,80 @@
+#include "VitraePluginOpenGL/Bits/CommandBuffer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace Vitrae;
+
+namespace
+{
+constexpr std::size_t NUM_SUBMISSIONS = 200000;
+constexpr std::size_t COMMANDS_PER_BUFFER = 4;
+} // namespace
+
+/*
+Measures how submitting command buffers scales with the number of recording threads,
+and checks that the replay runs every recorded command in the key order
+*/
+int main()
+{
+    std::size_t maxThreads = std::max(std::thread::hardware_concurrency(), 8u);
+    bool failed = false;
+
+    std::cout << "threads, submissions, ns per submission, submissions per second" << std::endl;
+
+    for (std::size_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+        GLCommandQueue queue;
+        std::atomic<std::size_t> numReplayed = 0;
+        std::vector<std::uint32_t> replayedKeys;
+        replayedKeys.reserve(NUM_SUBMISSIONS);
+
+        std::atomic<bool> start = false;
+        std::vector<std::thread> threads;
+        for (std::size_t threadIndex = 0; threadIndex < numThreads; ++threadIndex) {
+            threads.emplace_back([&, threadIndex]() {
+                while (!start.load(std::memory_order_acquire)) {
+                }
+
+                std::uint32_t orderKey = (std::uint32_t)threadIndex;
+                for (std::size_t i = threadIndex; i < NUM_SUBMISSIONS; i += numThreads) {
+                    GLCommandBuffer buffer(orderKey);
+                    for (std::size_t c = 0; c < COMMANDS_PER_BUFFER; ++c) {
+                        buffer.call([&]() { numReplayed.fetch_add(1, std::memory_order_relaxed); });
+                    }
+                    buffer.call([&, orderKey]() { replayedKeys.push_back(orderKey); });
+                    queue.submit(std::move(buffer));
+                }
+            });
+        }
+
+        auto startTime = std::chrono::steady_clock::now();
+        start.store(true, std::memory_order_release);
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+        auto submitDuration = std::chrono::steady_clock::now() - startTime;
+
+        queue.replayAll();
+
+        double nsPerSubmission =
+            (double)std::chrono::duration_cast<std::chrono::nanoseconds>(submitDuration).count() /
+            NUM_SUBMISSIONS;
+        std::cout << numThreads << ", " << NUM_SUBMISSIONS << ", " << nsPerSubmission << ", "
+                  << (std::size_t)(1e9 / nsPerSubmission) << std::endl;
+
+        if (numReplayed != NUM_SUBMISSIONS * COMMANDS_PER_BUFFER ||
+            replayedKeys.size() != NUM_SUBMISSIONS ||
+            !std::is_sorted(replayedKeys.begin(), replayedKeys.end())) {
+            std::cerr << "Replay with " << numThreads << " threads lost or reordered commands"
+                      << std::endl;
+            failed = true;
+        }
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+#include "VitraePluginOpenGL/Bits/ProgramBinaryCache.hpp"
+
+#include "glad/glad.h"
+
+#include "GLFW/glfw3.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+using namespace Vitrae;
+
+namespace
+{
+// ctest treats this as a skip, for machines without a software GL implementation
+constexpr int SKIP_RETURN_CODE = 77;
+
+// explicit locations and bindings like the generated code uses, with some inputs left unused;
+// std140 blocks count as active even when unused, so none of them is left unused
+const char *VERTEX_SOURCE = R"(#version 450 core
+layout(location=0) in vec3 elem_position;
+layout(location=0) uniform mat4 uniform_mat_mvp;
+layout(location=4) uniform float uniform_unused;
+layout(std140, binding=2) uniform ubo_block_light { vec4 ubo_light; };
+void main() {
+    gl_Position = uniform_mat_mvp * vec4(elem_position, 1.0) + ubo_light;
+}
+)";
+
+const char *FRAGMENT_SOURCE = R"(#version 450 core
+layout(location=5) uniform vec4 uniform_color;
+layout(location=6, binding=3) uniform sampler2D bind_tex_base;
+layout(location=7, binding=1) uniform sampler2D bind_tex_unused;
+layout(std430, binding=5) buffer buffer_block_weights { float buffer_weights[]; };
+layout(location=0) out vec4 frag_color;
+void main() {
+    frag_color = uniform_color * texture(bind_tex_base, vec2(0.5)) * buffer_weights[0];
+}
+)";
+
+GLuint compileStage(GLenum shaderType, const char *source)
+{
+    GLuint shader = glCreateShader(shaderType);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    return shader;
+}
+
+bool expectSame(const char *what, std::vector<GLint> actual, std::vector<GLint> expected)
+{
+    std::sort(actual.begin(), actual.end());
+    std::sort(expected.begin(), expected.end());
+    if (actual == expected) {
+        return true;
+    }
+
+    std::cerr << what << " differ; got";
+    for (GLint value : actual) {
+        std::cerr << " " << value;
+    }
+    std::cerr << ", expected";
+    for (GLint value : expected) {
+        std::cerr << " " << value;
+    }
+    std::cerr << std::endl;
+    return false;
+}
+} // namespace
+
+/*
+Checks on a software GL context that the reflection sweep reports exactly the explicit locations
+and bindings of the active inputs, and none of the ones the linker optimized out
+*/
+int main()
+{
+#ifdef GLFW_PLATFORM_NULL
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+    if (glfwInit() != GLFW_TRUE) {
+        std::cerr << "No GLFW platform available; skipping" << std::endl;
+        return SKIP_RETURN_CODE;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    // software implementations such as llvmpipe stop at 4.5; reflection is core since 4.3
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *p_window = glfwCreateWindow(1, 1, "", nullptr, nullptr);
+    if (p_window == nullptr) {
+        std::cerr << "No software GL 4.5 context available; skipping" << std::endl;
+        glfwTerminate();
+        return SKIP_RETURN_CODE;
+    }
+    glfwMakeContextCurrent(p_window);
+    gladLoadGL();
+
+    GLuint program = glCreateProgram();
+    GLuint vertexShader = compileStage(GL_VERTEX_SHADER, VERTEX_SOURCE);
+    GLuint fragmentShader = compileStage(GL_FRAGMENT_SHADER, FRAGMENT_SOURCE);
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+
+    bool passed = true;
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        std::cerr << "Link failed: " << log << std::endl;
+        passed = false;
+    } else {
+        GLActiveProgramInterface activeInterface = GLActiveProgramInterface::query(program);
+
+        passed &= expectSame("Uniform locations", activeInterface.uniformLocations, {0, 5, 6});
+        passed &= expectSame("UBO bindings", activeInterface.uniformBlockBindings, {2});
+        passed &= expectSame("SSBO bindings", activeInterface.storageBlockBindings, {5});
+
+        // the reflected locations have to be the ones the uniforms are set through
+        for (auto [name, location] : {std::pair{"uniform_mat_mvp", 0},
+                                      std::pair{"uniform_color", 5},
+                                      std::pair{"bind_tex_base", 6}}) {
+            if (glGetUniformLocation(program, name) != location) {
+                std::cerr << name << " isn't at location " << location << std::endl;
+                passed = false;
+            }
+        }
+        GLint texUnit = -1;
+        glGetUniformiv(program, 6, &texUnit);
+        if (texUnit != 3) {
+            std::cerr << "bind_tex_base isn't bound to unit 3" << std::endl;
+            passed = false;
+        }
+    }
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    glDeleteProgram(program);
+    glfwDestroyWindow(p_window);
+    glfwTerminate();
+
+    return passed ? 0 : 1;
+}